@@ -20,29 +20,76 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include "core-util/CriticalSectionLock.h"
 #include "core-util/PoolAllocator.h"
 #include "core-util/assert.h"
+#include "core-util/atomic_ops.h"
 #include "ualloc/ualloc.h"
 
 
 namespace mbed {
 namespace util {
 
+/** Storage modes for Array (see Array::init)
+  */
+enum array_mode_t {
+    array_segmented,        // linked zones (the default)
+    array_contiguous,       // a single zone, moved to a larger zone when the array grows
+    array_concurrent        // linked zones, elements can be added concurrently without critical sections
+};
+
 /** A reentrant Array class (elements can be accessed by index). It holds copies of the given type (T).
   *
   * The 'push_back' function can be used to add new entries to the array. If there's not enough space
-  * available, the Array will try to allocate more memory and grow automatically. The array can only
-  * grow, never shrink.
+  * available, the Array will try to allocate more memory and grow automatically. The array doesn't
+  * shrink by itself, but its memory can be compacted with 'shrink_to_fit'.
   *
   * This is not a sparse array. Trying to access elements outside the current array size will result
   * in a runtime error or cause undefined behaviour.
   *
-  * If the templated type is a class or a struct, it needs to have a copy constructor
+  * If the templated type is a class or a struct, it needs to have a copy constructor (or a move
+  * constructor, if the elements are only added with 'push_back(T&&)' or 'emplace_back')
+  *
+  * Accessing an element by index takes constant time, regardless of the number of zones in the
+  * array: the first zone is accessed directly and the address of each 'grow_capacity' elements
+  * after it is kept in a directory.
+  *
+  * A new element is visible (it is counted by 'get_num_elements()') only after it was constructed.
+  * When more than one context adds elements at the same time, the new elements become visible when
+  * the last of these contexts finishes constructing its element. Adding elements only takes a
+  * critical section when the array needs to grow; otherwise the space for the new elements is
+  * reserved with atomic operations.
+  *
+  * In contiguous mode (see 'init'), the array always has a single zone and its elements are stored
+  * exactly like in a C array, so they can be accessed directly with 'data()'. When
+  * the array needs to grow, its elements are moved to a larger zone (with memcpy if T is trivially
+  * copyable, with T's move constructor otherwise). This invalidates all pointers and references
+  * to the elements of the array, so an array in contiguous mode is NOT reentrant.
+  *
+  * In concurrent mode, elements can be added by many threads at the same time without critical
+  * sections: the space for new elements is reserved with an atomic update, the elements are
+  * constructed and then marked as ready with a per-element flag. The contexts that add elements
+  * advance the number of visible elements over all the consecutive ready elements, so a context
+  * never waits for another one to finish constructing its element. A critical section is still
+  * used when the array needs a new zone. This mode uses one more byte of memory for each element.
+  *
+  * The elements can be traversed with random access iterators ('begin()', 'end()'), or zone by
+  * zone with 'for_each_span()', which gives the callback plain (pointer, count) spans that can be
+  * processed with tight loops.
   */
 template <typename T>
 class Array {
+    template <typename V> class array_iterator;
+
 public:
+    typedef array_iterator<T> iterator;
+    typedef array_iterator<const T> const_iterator;
+
     /** Create a new array
       */
     Array() {}
@@ -60,34 +107,26 @@ public:
             p->~T();
         }
         // Now it's safe to destroy our internal data structures
-        array_link *crt = _head, *prev;
-        while (crt != NULL) {
-            prev = crt->prev;
-            void *addr = crt->data;
-            crt->~array_link(); // not really needed, just for completion
-            mbed_ufree(addr);
-            crt = prev;
-        }
+        free_zones(_head, _directory);
     }
 
     /** Initialize the array
       * @param initial_capacity initial number of elements in the array
       * @param grow_capacity number of elements to add when the array runs out of memory
       * @param alloc_traits allocator traits (for mbed_ualloc)
-      * @param alignment alignment of each element in the array
+      * @param alignment alignment of each element in the array (ignored in contiguous mode)
+      * @param mode storage mode of the array:
+      *        - array_segmented: the array grows by linking a new zone of 'grow_capacity' elements.
+      *        - array_contiguous: all the elements are kept in a single contiguous memory area. The
+      *          capacity of the array grows by at least 'grow_capacity' elements and at least doubles
+      *          each time the array runs out of memory.
+      *        - array_concurrent: like 'array_segmented', but elements can be added concurrently
+      *          without critical sections.
       * @returns true if the initialization succeeded, false otherwise
       */
-    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
-        if (_head != NULL)
-            return false; // prevent repeated initialization
-        _element_size = PoolAllocator::align_up(sizeof(T), alignment);
-        _grow_capacity = grow_capacity;
-        _alloc_traits = alloc_traits;
-        _alignment = alignment;
-        _capacity = initial_capacity;
-        _elements = 0;
-        _head = create_new_array(initial_capacity);
-        return _head != NULL;
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN,
+              array_mode_t mode = array_segmented) {
+        return init_with_storage(initial_capacity, grow_capacity, alloc_traits, alignment, mode, NULL);
     }
 
     /** Subscript operator: return a reference to an existing element
@@ -134,53 +173,243 @@ public:
       * @returns true if the element was added, false otherwise (out of memory/uninitialised)
       */
     bool push_back(const T& new_element) {
-        unsigned idx = _elements, prev_capacity = _capacity;
+        return emplace_back(new_element);
+    }
 
-        // element_size is calculated in the init method, thus this can be tested to determine
-        // whether or not init has been called previously.
-        if (_element_size == 0){
-            // Init function has not been invoked thus it is illegal to add an element
+    /** Adds an element at the end of the array, moving it into the array
+      * If there's not enough memory for a new element, a new zone will be allocated
+      * @param new_element element to add
+      * @returns true if the element was added, false otherwise (out of memory/uninitialised)
+      */
+    bool push_back(T&& new_element) {
+        return emplace_back(std::move(new_element));
+    }
+
+    /** Constructs an element in place at the end of the array
+      * If there's not enough memory for a new element, a new zone will be allocated
+      * @param args arguments for T's constructor
+      * @returns true if the element was added, false otherwise (out of memory/uninitialised)
+      */
+    template <typename... Args>
+    bool emplace_back(Args&&... args) {
+        unsigned idx;
+        if (!reserve_back(1, idx))
             return false;
-        }
+        size_t count;
+        new(get_span(idx, idx + 1, count)) T(std::forward<Args>(args)...);
+        commit_back(idx, 1);
+        return true;
+    }
 
-        if (_elements == _capacity) {
-            if (_grow_capacity == 0) { // can we grow?
-                return false;
-            }
-            {
-                CriticalSectionLock lock;
-                if (prev_capacity == _capacity) { // allocate only if someone else didn't
-                    if((_head = create_new_array(_grow_capacity, _elements, _head)) == NULL) {
-                        return false;
-                    }
-                    _capacity += _grow_capacity;
-                }
-            }
+    /** Adds copies of 'n' elements at the end of the array
+      * The array grows at most once (with a single new zone that has enough space for all the elements)
+      * and trivially copyable elements are copied with memcpy.
+      * @param src address of the elements to add
+      * @param n number of elements to add
+      * @returns true if all the elements were added, false otherwise (out of memory/uninitialised).
+      *          If the result is false, no element was added.
+      */
+    bool append(const T *src, size_t n) {
+        unsigned idx;
+        if (!reserve_back(n, idx))
+            return false;
+        unsigned last = idx + n;
+        while (idx < last) {
+            size_t count;
+            uint8_t *p = get_span(idx, last, count);
+            copy_elements(p, src, count, std::is_trivially_copyable<T>());
+            src += count;
+            idx += count;
         }
-        {
-            // TODO: this will eventually be 'atomic_set(&_elements);' after we figure
-            // out the atomic access primitives
-            CriticalSectionLock lock;
-            _elements ++;
+        commit_back(last - n, n);
+        return true;
+    }
+
+    /** Adds copies of the elements in the range [first, last) at the end of the array
+      * Like append(src, n), the array grows at most once and the elements are reserved and made
+      * visible only once for the whole range.
+      * @param first iterator to the first element (a forward iterator)
+      * @param last iterator past the last element
+      * @returns true if all the elements were added, false otherwise (out of memory/uninitialised).
+      *          If the result is false, no element was added.
+      */
+    template <typename ForwardIt>
+    bool append(ForwardIt first, ForwardIt last) {
+        size_t n = std::distance(first, last);
+        unsigned idx;
+        if (!reserve_back(n, idx))
+            return false;
+        unsigned end = idx + n;
+        while (idx < end) {
+            size_t count;
+            uint8_t *p = get_span(idx, end, count);
+            for (size_t i = 0; i < count; i ++, p += _element_size, ++ first)
+                new(p) T(*first);
+            idx += count;
         }
-        new(get_element_address(idx)) T(new_element);
+        commit_back(end - n, n);
         return true;
     }
 
     /** Removes the last element in the array
+      * In concurrent mode, this function must not be called concurrently with functions that
+      * add elements to the array.
+      * @returns true if an element was removed, false if the array is empty or if other contexts
+      *          are adding elements to the array
       */
-    void pop_back() {
+    bool pop_back() {
         T *p = NULL;
         {
             CriticalSectionLock lock;
-            if (_elements > 0) {
+            if ((_elements > 0) && (_reserved == _elements)) {
                 p = get_element_address(_elements - 1);
-                --_elements;
+                if (_first_ready != NULL)
+                    *get_ready_flag(_elements - 1) = 0;
+                _reserved = --_elements;
             }
         }
         if (p != NULL) {
             p->~T();
         }
+        return p != NULL;
+    }
+
+    /** Make sure that the array has space for at least 'n' elements
+      * If the array needs to grow, a single new zone is allocated. In contiguous mode, the elements
+      * are moved to a new zone with exactly 'n' elements. Otherwise, the new zone has the smallest
+      * multiple of 'grow_capacity' elements that covers the difference.
+      * @param n number of elements
+      * @returns true if the array has space for 'n' elements, false otherwise (out of memory/uninitialized
+      *          or the array can't grow because 'grow_capacity' is 0)
+      */
+    bool reserve(size_t n) {
+        if (_element_size == 0)
+            return false;
+        CriticalSectionLock lock;
+        if (n <= _capacity)
+            return true;
+        if (_grow_capacity == 0)
+            return false;
+        if (_mode == array_contiguous)
+            return relocate(n);
+        lock_growth();
+        bool res = n <= _capacity || grow((n - _capacity + _grow_capacity - 1) / _grow_capacity);
+        unlock_growth();
+        return res;
+    }
+
+    /** Removes all the elements in the array
+      * The memory of the array isn't released (see 'shrink_to_fit').
+      * This function must not be called concurrently with other functions that access the array.
+      */
+    void clear() {
+        for (unsigned i = 0; i < _elements; i ++) {
+            get_element_address(i)->~T();
+            if (_first_ready != NULL)
+                *get_ready_flag(i) = 0;
+        }
+        _elements = _reserved = 0;
+    }
+
+    /** Moves all the elements of the array to a single zone that has exactly the size needed for
+      * them and releases all the other zones. The next zones will be allocated as usual.
+      * This function must not be called concurrently with other functions that access the array
+      * and it invalidates all the pointers and references to the elements of the array.
+      * @returns true if the array was compacted, false otherwise (out of memory/uninitialized)
+      */
+    bool shrink_to_fit() {
+        if (_head == NULL)
+            return false;
+        if ((_capacity == _elements) && (_head->prev == NULL))
+            return true; // nothing to do
+        return relocate(_elements);
+    }
+
+    /** Returns the address of the elements of an array in contiguous mode
+      * The address changes when the array grows.
+      * @returns address of the first element or NULL if the array isn't in contiguous mode
+      */
+    T *data() {
+        return _mode == array_contiguous ? (T*)_first_data : NULL;
+    }
+
+    /** Returns the address of the elements of an array in contiguous mode (const version)
+      * @returns address of the first element or NULL if the array isn't in contiguous mode
+      */
+    const T *data() const {
+        return _mode == array_contiguous ? (const T*)_first_data : NULL;
+    }
+
+    /** Returns an iterator to the first element of the array
+      * @returns iterator to the first element
+      */
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    /** Returns an iterator to the first element of the array (const version)
+      * @returns iterator to the first element
+      */
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    /** Returns an iterator past the last element of the array
+      * @returns iterator past the last element
+      */
+    iterator end() {
+        return iterator(this, _elements);
+    }
+
+    /** Returns an iterator past the last element of the array (const version)
+      * @returns iterator past the last element
+      */
+    const_iterator end() const {
+        return const_iterator(this, _elements);
+    }
+
+    /** Call a function for each contiguous span of elements in the array, in order
+      * The function is called as 'f(T *elements, size_t count)'. Spans never cross zone boundaries;
+      * each zone of the array is a single span (zones created by 'append' or 'reserve' are split in
+      * spans of 'grow_capacity' elements), unless the elements are padded (because of the alignment
+      * given to 'init'), in which case each element is a separate span.
+      * @param f function (or function object) to call for each span
+      */
+    template <typename F>
+    void for_each_span(F&& f) {
+        unsigned elements = _elements;
+        for (unsigned idx = 0; idx < elements; ) {
+            size_t count;
+            T *p = (T*)get_span(idx, elements, count);
+            if (_element_size != sizeof(T))
+                count = 1;
+            f(p, count);
+            idx += count;
+        }
+    }
+
+    /** Call a function for each contiguous span of elements in the array, in order (const version)
+      * The function is called as 'f(const T *elements, size_t count)'.
+      * @param f function (or function object) to call for each span
+      */
+    template <typename F>
+    void for_each_span(F&& f) const {
+        unsigned elements = _elements;
+        for (unsigned idx = 0; idx < elements; ) {
+            size_t count;
+            const T *p = (const T*)get_span(idx, elements, count);
+            if (_element_size != sizeof(T))
+                count = 1;
+            f(p, count);
+            idx += count;
+        }
+    }
+
+    /** Check if the array is in contiguous mode
+      * @returns true if the array is in contiguous mode, false otherwise
+      */
+    bool is_contiguous() const {
+        return _mode == array_contiguous;
     }
 
     /** Return the number of zones (linked memory areas) in this array
@@ -210,41 +439,528 @@ public:
         return _capacity;
     }
 
+    /** Returns the size of the memory needed for a zone with 'elements' elements that are not
+      * padded (see SmallArray)
+      * @param elements number of elements in the zone
+      * @returns size of the zone in bytes
+      */
+    static constexpr size_t get_zone_storage_size(size_t elements) {
+        // Elements, ready flags (for concurrent mode), padding and the zone's array_link
+        return ((sizeof(T) * elements + elements + sizeof(void*) - 1) & ~(sizeof(void*) - 1)) + sizeof(array_link);
+    }
+
+protected:
+    // Initialize the array. If 'storage' is not NULL, it is used for the first zone instead of
+    // allocating it (it must have 'get_zone_storage_size(initial_capacity)' bytes and the elements
+    // must not be padded). The array switches back to that storage when 'shrink_to_fit' is called
+    // and the elements fit in it.
+    bool init_with_storage(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment,
+                           array_mode_t mode, void *storage) {
+        if (_head != NULL)
+            return false; // prevent repeated initialization
+        _mode = mode;
+        _element_size = mode == array_contiguous ? sizeof(T) : PoolAllocator::align_up(sizeof(T), alignment);
+        _grow_capacity = grow_capacity;
+        _alloc_traits = alloc_traits;
+        _alignment = alignment;
+        _capacity = initial_capacity;
+        _elements = _reserved = 0;
+        if (storage != NULL) {
+            CORE_UTIL_ASSERT(_element_size == sizeof(T));
+            _inline_storage = (uint8_t*)storage;
+            _inline_capacity = initial_capacity;
+        }
+        _head = create_new_array(initial_capacity, NULL, storage);
+        if (_head == NULL)
+            return false;
+        _first_data = _head->data;
+        _first_ready = get_ready_flags(_head->data, initial_capacity);
+        _first_capacity = initial_capacity;
+        return true;
+    }
+
+    // Returns true if all the elements of the array are in the storage given to 'init_with_storage'
+    bool uses_only_storage() const {
+        return (_head != NULL) && (_first_data == _inline_storage) && (_head->prev == NULL);
+    }
+
 private:
+    // Random access iterator. It keeps the address of the current element and the limits of its
+    // zone, so that sequential traversal doesn't need to look up the address of each element.
+    template <typename V>
+    class array_iterator {
+        typedef typename std::conditional<std::is_const<V>::value, const Array, Array>::type array_type;
+        friend class Array;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef typename std::remove_const<V>::type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V *pointer;
+        typedef V &reference;
+
+        array_iterator(): _array(NULL), _idx(0), _ptr(NULL), _zone_start(NULL), _zone_end(NULL) {}
+
+        /* Allow conversion from iterator to const_iterator */
+        array_iterator(const array_iterator<value_type>& it): _array(it._array), _idx(it._idx),
+            _ptr(it._ptr), _zone_start(it._zone_start), _zone_end(it._zone_end) {
+        }
+
+        reference operator *() const {
+            return *(pointer)_ptr;
+        }
+
+        pointer operator ->() const {
+            return (pointer)_ptr;
+        }
+
+        reference operator [](difference_type n) const {
+            return *(*this + n);
+        }
+
+        array_iterator& operator ++() {
+            _idx ++;
+            if ((_ptr += _array->_element_size) == _zone_end)
+                seek(_idx);
+            return *this;
+        }
+
+        array_iterator operator ++(int) {
+            array_iterator temp(*this);
+            ++ *this;
+            return temp;
+        }
+
+        array_iterator& operator --() {
+            _idx --;
+            if (_ptr == _zone_start)
+                seek(_idx);
+            else
+                _ptr -= _array->_element_size;
+            return *this;
+        }
+
+        array_iterator operator --(int) {
+            array_iterator temp(*this);
+            -- *this;
+            return temp;
+        }
+
+        array_iterator& operator +=(difference_type n) {
+            seek(_idx + n);
+            return *this;
+        }
+
+        array_iterator& operator -=(difference_type n) {
+            seek(_idx - n);
+            return *this;
+        }
+
+        array_iterator operator +(difference_type n) const {
+            return array_iterator(_array, _idx + n);
+        }
+
+        friend array_iterator operator +(difference_type n, const array_iterator& it) {
+            return it + n;
+        }
+
+        array_iterator operator -(difference_type n) const {
+            return array_iterator(_array, _idx - n);
+        }
+
+        difference_type operator -(const array_iterator& it) const {
+            return (difference_type)_idx - (difference_type)it._idx;
+        }
+
+        bool operator ==(const array_iterator& it) const { return _idx == it._idx; }
+        bool operator !=(const array_iterator& it) const { return _idx != it._idx; }
+        bool operator <(const array_iterator& it) const { return _idx < it._idx; }
+        bool operator >(const array_iterator& it) const { return _idx > it._idx; }
+        bool operator <=(const array_iterator& it) const { return _idx <= it._idx; }
+        bool operator >=(const array_iterator& it) const { return _idx >= it._idx; }
+
+    private:
+        friend class array_iterator<const V>;
+
+        array_iterator(array_type *array, unsigned idx): _array(array) {
+            seek(idx);
+        }
+
+        void seek(unsigned idx) {
+            _idx = idx;
+            if (idx < _array->_capacity) {
+                size_t count;
+                _ptr = _array->get_span(idx, _array->_capacity, count);
+                _zone_start = _ptr - (idx - _array->get_zone_first_idx(idx)) * _array->_element_size;
+                _zone_end = _ptr + count * _array->_element_size;
+            } else {
+                _ptr = _zone_start = _zone_end = NULL;
+            }
+        }
+
+        array_type *_array;
+        unsigned _idx;
+        uint8_t *_ptr, *_zone_start, *_zone_end;
+    };
+
     struct array_link {
-        array_link(void *_data, unsigned _first_idx, array_link *_prev):
+        array_link(void *_data, array_link *_prev, bool _allocated = true):
             data((uint8_t*)_data),
-            first_idx(_first_idx),
-            prev(_prev) {
+            prev(_prev),
+            allocated(_allocated) {
         }
 
         uint8_t *data;
-        unsigned first_idx;
         array_link *prev;
+        bool allocated;             // false if the zone uses storage given to 'init_with_storage'
+    };
+
+    // Directory of zones: zones[k] is the address of the elements
+    // [_first_capacity + k * _grow_capacity, _first_capacity + (k + 1) * _grow_capacity).
+    // A zone can have a multiple of '_grow_capacity' elements, in which case it takes more than one entry.
+    // When the directory needs to grow, a new (larger) copy is created and the previous one is kept
+    // (and linked to the new one with 'prev') until the array is destroyed, since readers might
+    // still use it. Because the size of the directory doubles, this at most doubles its memory usage.
+    struct zone_entry {
+        uint8_t *data;
+        volatile uint8_t *ready;        // ready flags of the elements (only in concurrent mode)
+    };
+
+    struct zone_directory {
+        zone_directory *prev;
+        size_t size;
+        zone_entry zones[1];
     };
 
-    array_link *create_new_array(size_t elements, unsigned first_idx = 0, array_link *prev = NULL) const {
+    static const size_t initial_directory_size = 4;
+
+    array_link *create_new_array(size_t elements, array_link *prev = NULL, void *storage = NULL) const {
         // Create the array space + an array_link structure in the same contigous memory area
-        // Layout: array storage area | array_link structure
-        // Since the array elements are aligned to at least 4 bytes, the array_link address will be correctly aligned
-        size_t array_storage_size = _element_size * elements;
-        void *temp = mbed_ualloc(array_storage_size + sizeof(array_link), _alloc_traits);
+        // Layout: array storage area | ready flags (concurrent mode only) | padding | array_link structure
+        // The padding (if any) makes sure that the array_link address is correctly aligned
+        size_t flags_size = _mode == array_concurrent ? elements : 0;
+        size_t array_storage_size = (_element_size * elements + flags_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+        void *temp = storage != NULL ? storage : mbed_ualloc(array_storage_size + sizeof(array_link), _alloc_traits);
         if (temp == NULL)
             return NULL;
-        array_link *p = new((char*)temp + array_storage_size) array_link(temp, first_idx, prev);
+        if (flags_size > 0)
+            memset((uint8_t*)temp + _element_size * elements, 0, flags_size);
+        array_link *p = new((char*)temp + array_storage_size) array_link(temp, prev, storage == NULL);
         return p;
     }
 
-    T *get_element_address(unsigned idx) const {
-        array_link *crt = _head;
+    // Make sure that the zone directory has at least 'zones' entries
+    bool reserve_directory(size_t zones) {
+        zone_directory *dir = _directory;
+        if ((dir != NULL) && (dir->size >= zones))
+            return true;
+        size_t size = dir == NULL ? initial_directory_size : dir->size * 2;
+        while (size < zones)
+            size *= 2;
+        zone_directory *new_dir = (zone_directory*)mbed_ualloc(sizeof(zone_directory) + (size - 1) * sizeof(zone_entry), _alloc_traits);
+        if (new_dir == NULL)
+            return false;
+        new_dir->prev = dir;
+        new_dir->size = size;
+        size_t used = (_capacity - _first_capacity) / _grow_capacity;
+        for (size_t i = 0; i < used; i ++)
+            new_dir->zones[i] = dir->zones[i];
+        _directory = new_dir;
+        return true;
+    }
 
-        CORE_UTIL_ASSERT(idx < _elements);
-        // first_idx in the first allocated array is 0, so the loop below is guaranteed to end
-        while(idx < crt->first_idx) {
-            crt = crt->prev;
+    // Add a new zone with 'zones' * '_grow_capacity' elements. It takes 'zones' entries in the
+    // directory. Must be called with interrupts disabled.
+    bool grow(size_t zones = 1) {
+        size_t zone = (_capacity - _first_capacity) / _grow_capacity;
+        if (!reserve_directory(zone + zones))
+            return false;
+        array_link *link = create_new_array(zones * _grow_capacity, _head);
+        if (link == NULL)
+            return false;
+        // Update the directory before the capacity, so that readers never see an unset entry
+        volatile uint8_t *ready = get_ready_flags(link->data, zones * _grow_capacity);
+        for (size_t i = 0; i < zones; i ++) {
+            _directory->zones[zone + i].data = link->data + i * _grow_capacity * _element_size;
+            _directory->zones[zone + i].ready = ready == NULL ? NULL : ready + i * _grow_capacity;
+        }
+        _head = link;
+        _capacity += zones * _grow_capacity;
+        return true;
+    }
+
+    // Reserve space for 'n' new elements at the end of the array, growing it if needed.
+    // 'idx' is set to the index of the first new element. The new elements must be constructed and
+    // then made visible with 'commit_back'.
+    bool reserve_back(size_t n, unsigned &idx) {
+        // element_size is calculated in the init method, thus this can be tested to determine
+        // whether or not init has been called previously.
+        if (_element_size == 0){
+            // Init function has not been invoked thus it is illegal to add an element
+            return false;
+        }
+
+        if (_mode == array_concurrent) {
+            uint32_t reserved = _reserved;
+            while (true) {
+                if (reserved + n > _capacity) {
+                    if (!grow_concurrent(reserved + n))
+                        return false;
+                    reserved = _reserved;
+                } else if (atomic_cas((uint32_t*)&_reserved, &reserved, (uint32_t)(reserved + n))) {
+                    break;
+                }
+            }
+            idx = reserved;
+            return true;
+        }
+
+        // The context announces itself in '_appending' before it reserves its elements, so they
+        // are not made visible by another context before they are constructed (see 'end_append')
+        atomic_incr((uint32_t*)&_appending, (uint32_t)1);
+        // If the new elements fit in the current capacity, they are reserved without a critical section
+        uint32_t reserved = _reserved;
+        while (reserved + n <= _capacity) {
+            if (atomic_cas((uint32_t*)&_reserved, &reserved, (uint32_t)(reserved + n))) {
+                idx = reserved;
+                return true;
+            }
+        }
+        // Otherwise the array needs to grow
+        bool res;
+        {
+            CriticalSectionLock lock;
+            idx = _reserved;
+            res = ensure_capacity(idx + n);
+            if (res)
+                _reserved = idx + n;
         }
-        CORE_UTIL_ASSERT(crt != NULL);
-        return (T*)(crt->data + _element_size * (idx - crt->first_idx));
+        if (!res)
+            end_append();
+        return res;
+    }
+
+    // Make the 'n' elements starting at 'idx' (reserved with 'reserve_back' and constructed) visible
+    void commit_back(unsigned idx, size_t n) {
+        if (_mode != array_concurrent) {
+            end_append();
+            return;
+        }
+
+        for (size_t i = 0; i < n; i ++) {
+            uint8_t not_ready = 0;
+            atomic_cas((uint8_t*)get_ready_flag(idx + i), &not_ready, (uint8_t)1);
+        }
+        // Advance the number of visible elements over all the consecutive ready elements. If the
+        // element at '_elements' isn't ready yet, the context that constructs it will do this.
+        uint32_t elements = _elements;
+        while ((elements < _reserved) && *get_ready_flag(elements)) {
+            uint32_t last = elements + 1, reserved = _reserved;
+            while ((last < reserved) && *get_ready_flag(last))
+                last ++;
+            atomic_cas((uint32_t*)&_elements, &elements, last);
+            elements = _elements;
+        }
+    }
+
+    // Called (not in concurrent mode) when a context is done constructing its elements. The new
+    // elements are published only when no other context is still constructing its elements: the
+    // last context publishes all the elements that were reserved before it finished.
+    void end_append() {
+        uint32_t reserved = _reserved;
+        if (atomic_decr((uint32_t*)&_appending, (uint32_t)1) != 0)
+            return;
+        uint32_t elements = _elements;
+        while (true) {
+            // Don't go past '_reserved', in case 'pop_back' removed elements in the meantime
+            uint32_t target = _reserved < reserved ? _reserved : reserved;
+            if ((elements >= target) || atomic_cas((uint32_t*)&_elements, &elements, target))
+                break;
+        }
+    }
+
+    // Grow an array in concurrent mode, so that it has space for at least 'needed' elements
+    bool grow_concurrent(size_t needed) {
+        CriticalSectionLock lock;
+        lock_growth();
+        bool res = ensure_capacity(needed);
+        unlock_growth();
+        return res;
+    }
+
+    // In concurrent mode, a critical section doesn't stop other threads from growing the array on
+    // other cores (or on POSIX), so a flag protects the growth of the array. It is only set
+    // with interrupts disabled, so an interrupt handler never waits for a thread on the same core.
+    void lock_growth() {
+        if (_mode != array_concurrent)
+            return;
+        uint8_t expected = 0;
+        while (!atomic_cas((uint8_t*)&_growing, &expected, (uint8_t)1))
+            expected = 0;
+    }
+
+    void unlock_growth() {
+        if (_mode != array_concurrent)
+            return;
+        uint8_t expected = 1;
+        atomic_cas((uint8_t*)&_growing, &expected, (uint8_t)0);
+    }
+
+    // Make sure that the array has space for at least 'needed' elements. Must be called with
+    // interrupts disabled.
+    bool ensure_capacity(size_t needed) {
+        if (needed <= _capacity)
+            return true;
+        if (_grow_capacity == 0) // can we grow?
+            return false;
+        if (_mode == array_contiguous) {
+            size_t new_capacity = _capacity + (_grow_capacity > _capacity ? _grow_capacity : _capacity);
+            return relocate(new_capacity > needed ? new_capacity : needed);
+        }
+        return grow((needed - _capacity + _grow_capacity - 1) / _grow_capacity);
+    }
+
+    // Copy-construct 'n' elements at 'dest' (which is contiguous in the array)
+    void copy_elements(uint8_t *dest, const T *src, size_t n, std::true_type) {
+        if (_element_size == sizeof(T))
+            memcpy(dest, src, n * sizeof(T));
+        else
+            copy_elements(dest, src, n, std::false_type());
+    }
+
+    void copy_elements(uint8_t *dest, const T *src, size_t n, std::false_type) {
+        for (size_t i = 0; i < n; i ++, dest += _element_size)
+            new(dest) T(src[i]);
+    }
+
+    // Move all the elements to a new zone with 'new_capacity' elements, which becomes the first (and
+    // only) zone of the array. Must be called with interrupts disabled or from a non-reentrant context.
+    bool relocate(size_t new_capacity) {
+        void *storage = NULL;
+        if ((_inline_storage != NULL) && (new_capacity <= _inline_capacity)) {
+            // Use the storage given to 'init_with_storage'
+            new_capacity = _inline_capacity;
+            if (_first_data == _inline_storage) {
+                // The elements are already there, just release the other zones: find the first
+                // (oldest) zone and detach it from the newer ones
+                array_link *first = _head, *newer = NULL;
+                while (first->prev != NULL) {
+                    newer = first;
+                    first = first->prev;
+                }
+                array_link *old_head = NULL;
+                if (newer != NULL) {
+                    newer->prev = NULL;
+                    old_head = _head;
+                }
+                zone_directory *old_directory = _directory;
+                _head = first;
+                _directory = NULL;
+                _capacity = _first_capacity;
+                free_zones(old_head, old_directory);
+                return true;
+            }
+            storage = _inline_storage;
+        }
+        array_link *link = create_new_array(new_capacity, NULL, storage);
+        if (link == NULL)
+            return false;
+        uint8_t *dest = link->data;
+        for (unsigned idx = 0; idx < _elements; ) {
+            size_t count;
+            uint8_t *src = get_span(idx, _elements, count);
+            move_elements(dest, src, count, std::is_trivially_copyable<T>());
+            dest += count * _element_size;
+            idx += count;
+        }
+        array_link *old_head = _head;
+        zone_directory *old_directory = _directory;
+        _head = link;
+        _directory = NULL;
+        _first_data = link->data;
+        _first_ready = get_ready_flags(link->data, new_capacity);
+        _first_capacity = _capacity = new_capacity;
+        free_zones(old_head, old_directory);
+        return true;
+    }
+
+    // Move 'n' contiguous elements from 'src' to 'dest'
+    void move_elements(uint8_t *dest, uint8_t *src, size_t n, std::true_type) {
+        memcpy(dest, src, n * _element_size);
+    }
+
+    void move_elements(uint8_t *dest, uint8_t *src, size_t n, std::false_type) {
+        for (size_t i = 0; i < n; i ++, dest += _element_size, src += _element_size) {
+            new(dest) T(std::move(*(T*)src));
+            ((T*)src)->~T();
+        }
+    }
+
+    // Free a list of zones and a zone directory (with all its previous versions). Zones that use
+    // storage given to 'init_with_storage' are not freed.
+    static void free_zones(array_link *crt, zone_directory *dir) {
+        array_link *prev;
+        while (crt != NULL) {
+            prev = crt->prev;
+            void *addr = crt->data;
+            bool allocated = crt->allocated;
+            crt->~array_link(); // not really needed, just for completion
+            if (allocated)
+                mbed_ufree(addr);
+            crt = prev;
+        }
+        zone_directory *prev_dir;
+        while (dir != NULL) {
+            prev_dir = dir->prev;
+            mbed_ufree(dir);
+            dir = prev_dir;
+        }
+    }
+
+    // Returns the index of the first element in the zone of element 'idx'
+    unsigned get_zone_first_idx(unsigned idx) const {
+        if (idx < _first_capacity)
+            return 0;
+        return idx - (idx - _first_capacity) % _grow_capacity;
+    }
+
+    // Returns the address of element 'idx' and the number of elements (up to 'limit') that follow
+    // it contiguously in memory, starting with element 'idx'
+    uint8_t *get_span(unsigned idx, unsigned limit, size_t &count) const {
+        uint8_t *p;
+        size_t zone_left;
+        if (idx < _first_capacity) {
+            p = _first_data + _element_size * idx;
+            zone_left = _first_capacity - idx;
+        } else {
+            unsigned rel = idx - _first_capacity;
+            p = _directory->zones[rel / _grow_capacity].data + _element_size * (rel % _grow_capacity);
+            zone_left = _grow_capacity - rel % _grow_capacity;
+        }
+        count = limit - idx < zone_left ? limit - idx : zone_left;
+        return p;
+    }
+
+    T *get_element_address(unsigned idx) const {
+        CORE_UTIL_ASSERT(idx < _elements);
+        if (idx < _first_capacity)
+            return (T*)(_first_data + _element_size * idx);
+        idx -= _first_capacity;
+        return (T*)(_directory->zones[idx / _grow_capacity].data + _element_size * (idx % _grow_capacity));
+    }
+
+    // Returns the address of the ready flags of a zone that starts at 'data' and has 'elements' elements
+    // (NULL if the array isn't in concurrent mode)
+    volatile uint8_t *get_ready_flags(uint8_t *data, size_t elements) const {
+        return _mode == array_concurrent ? data + _element_size * elements : NULL;
+    }
+
+    // Returns the address of the ready flag of element 'idx' (concurrent mode only)
+    volatile uint8_t *get_ready_flag(unsigned idx) const {
+        if (idx < _first_capacity)
+            return _first_ready + idx;
+        idx -= _first_capacity;
+        return _directory->zones[idx / _grow_capacity].ready + idx % _grow_capacity;
     }
 
     void check_access(unsigned idx) const {
@@ -257,10 +973,21 @@ private:
     }
 
     array_link *volatile _head = NULL;
+    zone_directory *volatile _directory = NULL;
+    uint8_t *_first_data = NULL;
+    volatile uint8_t *_first_ready = NULL;
+    uint8_t *_inline_storage = NULL;
+    size_t _inline_capacity = 0;
     UAllocTraits_t _alloc_traits = {0};
-    size_t _element_size = 0, _grow_capacity = 0;
-    volatile unsigned _capacity = 0, _elements = 0;
+    size_t _element_size = 0, _grow_capacity = 0, _first_capacity = 0;
+    // '_reserved' counts the elements that were reserved by 'reserve_back', '_elements' counts the
+    // visible elements ('_elements' <= '_reserved')
+    volatile unsigned _capacity = 0, _elements = 0, _reserved = 0;
+    // Number of contexts that are constructing new elements (not in concurrent mode)
+    volatile uint32_t _appending = 0;
+    volatile uint8_t _growing = 0;
     unsigned _alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN;
+    array_mode_t _mode = array_segmented;
 };
 
 } // namespace util
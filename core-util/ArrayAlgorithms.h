@@ -0,0 +1,337 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_ARRAY_ALGORITHMS_H__
+#define __MBED_UTIL_ARRAY_ALGORITHMS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <new>
+#include <utility>
+#include "core-util/Array.h"
+#include "ualloc/ualloc.h"
+#if defined(TARGET_LIKE_POSIX)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* Arrays with fewer elements than this (per thread) are processed by a single thread */
+#ifndef YOTTA_CFG_CORE_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS
+#define YOTTA_CFG_CORE_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS 16384
+#endif
+
+#define MBED_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS YOTTA_CFG_CORE_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS
+
+/* Algorithms that work directly on the zones of an Array, without copying its elements out.
+ *
+ * On POSIX targets, sort(), transform() (in place) and reduce() (with a 'combine' operation) can
+ * split large arrays in chunks that are processed by different threads. The 'threads' argument of
+ * these functions is the maximum number of threads (0 selects the number of online CPUs); on other
+ * targets, they always run in the calling context. transform() calls a user function on the
+ * elements, so it runs in the calling context unless the caller asks for more threads (the
+ * function must then be thread-safe). The array must not be modified by other contexts while these
+ * functions run.
+ */
+
+namespace mbed {
+namespace util {
+
+namespace detail {
+
+// Maximum number of threads used by an algorithm
+static const unsigned array_max_threads = 32;
+
+// Default comparison (operator <). Both operands have the same type, so lower_bound() converts
+// the value it looks for to the type of the elements.
+struct array_less {
+    template <typename A>
+    bool operator ()(const A& a, const A& b) const {
+        return a < b;
+    }
+};
+
+// Returns the number of chunks (threads) used for processing 'n' elements
+inline unsigned array_get_num_chunks(size_t n, unsigned threads) {
+#if defined(TARGET_LIKE_POSIX)
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (threads > array_max_threads)
+        threads = array_max_threads;
+    size_t max_chunks = n / MBED_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS;
+    if (max_chunks < threads)
+        threads = max_chunks > 0 ? (unsigned)max_chunks : 1;
+    return threads;
+#else
+    (void)n;
+    (void)threads;
+    return 1;
+#endif
+}
+
+// Returns the index of the first element of chunk 'idx' when 'n' elements are split in 'chunks' chunks
+inline size_t array_chunk_start(size_t n, unsigned chunks, unsigned idx) {
+    return (size_t)((uint64_t)n * idx / chunks);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+template <typename F>
+struct array_task {
+    F *f;
+    unsigned idx;
+};
+
+template <typename F>
+void *array_task_thread(void *arg) {
+    array_task<F> *task = (array_task<F>*)arg;
+    (*task->f)(task->idx);
+    return NULL;
+}
+#endif
+
+// Call 'f(idx)' for each 'idx' in [0, tasks). On POSIX, each call runs in its own thread
+// (the first one runs in the calling thread).
+template <typename F>
+void array_run_tasks(unsigned tasks, F& f) {
+#if defined(TARGET_LIKE_POSIX)
+    pthread_t tids[array_max_threads];
+    array_task<F> args[array_max_threads];
+    bool started[array_max_threads];
+    for (unsigned i = 1; i < tasks; i ++) {
+        args[i].f = &f;
+        args[i].idx = i;
+        started[i] = pthread_create(&tids[i], NULL, array_task_thread<F>, &args[i]) == 0;
+    }
+    if (tasks > 0)
+        f(0);
+    for (unsigned i = 1; i < tasks; i ++) {
+        if (started[i])
+            pthread_join(tids[i], NULL);
+        else
+            f(i); // couldn't start a thread, run the task here
+    }
+#else
+    for (unsigned i = 0; i < tasks; i ++)
+        f(i);
+#endif
+}
+
+} // namespace detail
+
+/** Sort the elements of an array (the sort is not stable)
+  * On POSIX targets, large arrays are split in chunks that are sorted by different threads and
+  * then merged (also in parallel), using a temporary buffer of the size of the array allocated
+  * with mbed_ualloc. If the buffer can't be allocated, the array is sorted by the calling thread.
+  * T must be move constructible and move assignable.
+  * @param array the array to sort
+  * @param comp comparison function (or function object) that returns true if its first argument
+  *        should be placed before its second argument
+  * @param threads maximum number of threads (0 for the number of online CPUs)
+  */
+template <typename T, typename Compare = detail::array_less>
+void sort(Array<T>& array, Compare comp = Compare(), unsigned threads = 0) {
+    const size_t n = array.get_num_elements();
+    unsigned chunks = detail::array_get_num_chunks(n, threads);
+    T *buffer = NULL;
+    if (chunks > 1) {
+        UAllocTraits_t traits = {0};
+        buffer = (T*)mbed_ualloc(n * sizeof(T), traits);
+    }
+    if (buffer == NULL) {
+        std::sort(array.begin(), array.end(), comp);
+        return;
+    }
+
+    // Sort each chunk in place, then move it to the buffer
+    auto sort_chunk = [&](unsigned idx) {
+        size_t first = detail::array_chunk_start(n, chunks, idx), last = detail::array_chunk_start(n, chunks, idx + 1);
+        typename Array<T>::iterator it = array.begin() + first, end = array.begin() + last;
+        std::sort(it, end, comp);
+        for (T *dest = buffer + first; it != end; ++ it, ++ dest)
+            new(dest) T(std::move(*it));
+    };
+    detail::array_run_tasks(chunks, sort_chunk);
+
+    // Merge sorted runs of 'width' chunks, moving the elements between the buffer and the array
+    bool in_buffer = true;
+    for (unsigned width = 1; width < chunks; width *= 2) {
+        auto merge_runs = [&](unsigned idx) {
+            unsigned c0 = idx * 2 * width, c1 = std::min(c0 + width, chunks), c2 = std::min(c0 + 2 * width, chunks);
+            size_t first = detail::array_chunk_start(n, chunks, c0);
+            size_t middle = detail::array_chunk_start(n, chunks, c1);
+            size_t last = detail::array_chunk_start(n, chunks, c2);
+            if (in_buffer) {
+                std::merge(std::make_move_iterator(buffer + first), std::make_move_iterator(buffer + middle),
+                           std::make_move_iterator(buffer + middle), std::make_move_iterator(buffer + last),
+                           array.begin() + first, comp);
+            } else {
+                std::merge(std::make_move_iterator(array.begin() + first), std::make_move_iterator(array.begin() + middle),
+                           std::make_move_iterator(array.begin() + middle), std::make_move_iterator(array.begin() + last),
+                           buffer + first, comp);
+            }
+        };
+        detail::array_run_tasks((chunks + 2 * width - 1) / (2 * width), merge_runs);
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer)
+        std::move(buffer, buffer + n, array.begin());
+
+    for (size_t i = 0; i < n; i ++)
+        buffer[i].~T();
+    mbed_ufree(buffer);
+}
+
+/** Find the first element of a sorted array that is not ordered before a value (binary search)
+  * @param array the array, sorted according to 'comp'
+  * @param value the value to look for
+  * @param comp comparison function (or function object) called as 'comp(element, value)'
+  * @returns the index of the first element that is not ordered before 'value', or the number of
+  *          elements in the array if there is no such element
+  */
+template <typename T, typename V, typename Compare>
+unsigned lower_bound(const Array<T>& array, const V& value, Compare comp) {
+    unsigned first = 0, count = array.get_num_elements();
+    while (count > 0) {
+        unsigned step = count / 2, middle = first + step;
+        if (comp(array[middle], value)) {
+            first = middle + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+/** Find the first element of a sorted array that is not smaller than a value (binary search)
+  * @param array the array, sorted according to operator <
+  * @param value the value to look for (converted to T)
+  * @returns the index of the first element that is not smaller than 'value', or the number of
+  *          elements in the array if there is no such element
+  */
+template <typename T>
+unsigned lower_bound(const Array<T>& array, const typename std::common_type<T>::type& value) {
+    return lower_bound(array, value, detail::array_less());
+}
+
+/** Replace each element of an array with the result of a function applied to it
+  * With more than one thread, the same 'f' is called by several threads at the same time, so it
+  * must be thread-safe: for example, it must not update its own state without synchronization.
+  * @param array the array
+  * @param f function (or function object) called as 'f(element)'; its result is assigned to the element
+  * @param threads maximum number of threads (1 to run in the calling context, 0 for the number of
+  *        online CPUs)
+  */
+template <typename T, typename F>
+void transform(Array<T>& array, F f, unsigned threads = 1) {
+    const size_t n = array.get_num_elements();
+    const unsigned chunks = detail::array_get_num_chunks(n, threads);
+    auto transform_chunk = [&](unsigned idx) {
+        typename Array<T>::iterator it = array.begin() + detail::array_chunk_start(n, chunks, idx);
+        typename Array<T>::iterator end = array.begin() + detail::array_chunk_start(n, chunks, idx + 1);
+        for (; it != end; ++ it)
+            *it = f(*it);
+    };
+    detail::array_run_tasks(chunks, transform_chunk);
+}
+
+/** Add the result of a function applied to each element of an array at the end of another array
+  * @param src the source array
+  * @param dest the destination array (space for all the new elements is reserved first)
+  * @param f function (or function object) called as 'f(element)'
+  * @returns true if all the elements were added to 'dest', false otherwise (out of memory)
+  */
+template <typename T, typename U, typename F>
+bool transform(const Array<T>& src, Array<U>& dest, F f) {
+    const unsigned n = src.get_num_elements();
+    if (!dest.reserve(dest.get_num_elements() + n))
+        return false;
+    bool res = true;
+    src.for_each_span([&](const T *p, size_t count) {
+        for (size_t i = 0; (i < count) && res; i ++)
+            res = dest.push_back(f(p[i]));
+    });
+    return res;
+}
+
+/** Combine all the elements of an array with a binary operation, in the calling context
+  * The result is 'op(...op(op(init, a[0]), a[1])..., a[n - 1])'.
+  * @param array the array
+  * @param init initial value
+  * @param op binary operation, called as 'op(R, element)'
+  * @returns the result of the reduction
+  */
+template <typename T, typename R, typename F>
+R reduce(const Array<T>& array, R init, F op) {
+    array.for_each_span([&](const T *p, size_t count) {
+        for (size_t i = 0; i < count; i ++)
+            init = op(init, p[i]);
+    });
+    return init;
+}
+
+/** Combine all the elements of an array with a binary operation, possibly in parallel
+  * On POSIX targets, large arrays are split in chunks that are reduced by different threads: each
+  * chunk is folded with 'op', starting from 'identity', then the partial results of the chunks are
+  * combined in order with 'combine'. For the result to be the same as a sequential reduction,
+  * 'identity' must be an identity of 'combine' ('combine(identity, x) == x') and
+  * 'combine(x, op(y, element))' must be equal to 'op(combine(x, y), element)'. For example, a
+  * sum of squares uses 'op = [](R acc, T v) { return acc + v * v; }' and 'combine = std::plus<R>()'.
+  * 'op' is called by several threads at the same time, so it must be thread-safe.
+  * @param array the array
+  * @param identity initial value of the reduction of each chunk
+  * @param op binary operation, called as 'op(R, element)'
+  * @param combine binary operation, called as 'combine(R, R)'
+  * @param threads maximum number of threads (0 for the number of online CPUs)
+  * @returns the result of the reduction
+  */
+template <typename T, typename R, typename F, typename C>
+R reduce(const Array<T>& array, R identity, F op, C combine, unsigned threads = 0) {
+    const size_t n = array.get_num_elements();
+    const unsigned chunks = detail::array_get_num_chunks(n, threads);
+    if (chunks == 1)
+        return reduce(array, identity, op);
+
+    // Partial results (one per chunk), constructed by the threads
+    alignas(R) uint8_t storage[detail::array_max_threads * sizeof(R)];
+    R *partial = (R*)storage;
+    auto reduce_chunk = [&](unsigned idx) {
+        size_t first = detail::array_chunk_start(n, chunks, idx), last = detail::array_chunk_start(n, chunks, idx + 1);
+        typename Array<T>::const_iterator it = array.begin() + first, end = array.begin() + last;
+        R acc = identity;
+        for (; it != end; ++ it)
+            acc = op(acc, *it);
+        new(partial + idx) R(std::move(acc));
+    };
+    detail::array_run_tasks(chunks, reduce_chunk);
+    R res = std::move(partial[0]);
+    partial[0].~R();
+    for (unsigned i = 1; i < chunks; i ++) {
+        res = combine(res, partial[i]);
+        partial[i].~R();
+    }
+    return res;
+}
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_ARRAY_ALGORITHMS_H__
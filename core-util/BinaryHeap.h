@@ -20,6 +20,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <iterator>
+#include <utility>
 #include "core-util/CriticalSectionLock.h"
 #include "core-util/Array.h"
 #include "ualloc/ualloc.h"
@@ -88,19 +90,151 @@ public:
     }
 };
 
-template <typename T, typename Comparator=MinCompare<T> >
-class BinaryHeap {
+namespace detail {
+
+// The sift operations shared by all the heaps (BinaryHeap, DaryHeap, IndexedHeap and the
+// sub-queues of MultiQueue), for an implicit heap where the children of node 'i' are the D
+// adjacent nodes starting at 'D * i + 1'.
+//
+// The sift functions move a "hole" instead of swapping nodes: the node that moves is kept in a
+// local variable, the nodes that it passes are moved into the hole, and the node is written only
+// once, at its final position.
+//
+// 'Nodes' gives access to the nodes of a heap:
+//   typedef ... node_type;                          the type of a node
+//   const key_type& key(size_t i) const;            the value of node 'i'
+//   static const key_type& key_of(const node_type&) the value of a node that was taken out
+//   bool compare(const key_type&, const key_type&)  the comparator of the heap
+//   node_type take(size_t i);                       move node 'i' out (leaving a hole)
+//   void move(size_t to, size_t from);              move node 'from' into the hole at 'to'
+//   void put(size_t i, node_type&& n);              move 'n' into the hole at 'i'
+template <unsigned D>
+struct heap_sift {
+    static size_t parent(size_t i) {
+        return (i - 1) / D;
+    }
+
+    static size_t first_child(size_t i) {
+        return D * i + 1;
+    }
+
+    // Returns the child of 'pos' that should take the place of 'value' (which is at 'pos'), or
+    // 'size' if 'value' respects the comparison function with all the children
+    template <typename Nodes, typename Key>
+    static size_t select_child(const Nodes& nodes, size_t size, size_t pos, const Key& value) {
+        size_t first = first_child(pos);
+        if (first >= size)
+            return size;
+        size_t last = first + D < size ? first + D : size;
+        size_t best = first;
+        for (size_t child = first + 1; child < last; child ++) {
+            if (!nodes.compare(nodes.key(best), nodes.key(child)))
+                best = child;
+        }
+        return nodes.compare(value, nodes.key(best)) ? size : best;
+    }
+
+    // Move the node at 'pos' up until the heap property is satisfied (used when a node is added
+    // in the last position of the heap)
+    template <typename Nodes>
+    static void up(Nodes& nodes, size_t pos) {
+        if ((pos == 0) || !nodes.compare(nodes.key(pos), nodes.key(parent(pos))))
+            return;
+        typename Nodes::node_type n = nodes.take(pos);
+        do {
+            size_t p = parent(pos);
+            nodes.move(pos, p);
+            pos = p;
+        } while ((pos > 0) && nodes.compare(Nodes::key_of(n), nodes.key(parent(pos))));
+        nodes.put(pos, std::move(n));
+    }
+
+    // Move the node at 'pos' down until the heap property is satisfied (used when a node is
+    // replaced with the node in the last position of the heap)
+    template <typename Nodes>
+    static void down(Nodes& nodes, size_t size, size_t pos) {
+        size_t child = select_child(nodes, size, pos, nodes.key(pos));
+        if (child == size)
+            return;
+        typename Nodes::node_type n = nodes.take(pos);
+        do {
+            nodes.move(pos, child);
+            pos = child;
+        } while ((child = select_child(nodes, size, pos, Nodes::key_of(n))) != size);
+        nodes.put(pos, std::move(n));
+    }
+
+    // Move the node at 'pos' up or down, whichever is needed to make the heap consistent
+    template <typename Nodes>
+    static void restore(Nodes& nodes, size_t size, size_t pos) {
+        if ((pos > 0) && !nodes.compare(nodes.key(parent(pos)), nodes.key(pos)))
+            up(nodes, pos);
+        else
+            down(nodes, size, pos);
+    }
+
+    // Floyd's bottom-up heap construction: sift down every node that has children, starting
+    // with the last one
+    template <typename Nodes>
+    static void heapify(Nodes& nodes, size_t size) {
+        if (size < 2)
+            return;
+        for (size_t pos = parent(size - 1) + 1; pos -- > 0; )
+            down(nodes, size, pos);
+    }
+};
+
+// 'Nodes' for a heap that stores its values directly in 'Storage' (an Array<T> or a T*)
+template <typename T, typename Comparator, typename Storage>
+class heap_values {
 public:
-    /** Construct a new binary heap
-      */
-    BinaryHeap(const Comparator& comparator = Comparator()): _array(), _comparator(comparator) {
+    typedef T node_type;
+
+    heap_values(Storage& storage, const Comparator& comparator): _storage(storage), _comparator(comparator) {
+    }
+
+    const T& key(size_t i) const {
+        return _storage[i];
+    }
+
+    static const T& key_of(const T& value) {
+        return value;
+    }
+
+    bool compare(const T& e1, const T& e2) const {
+        return _comparator(e1, e2);
+    }
+
+    T take(size_t i) {
+        return std::move(_storage[i]);
+    }
+
+    void move(size_t to, size_t from) {
+        _storage[to] = std::move(_storage[from]);
+    }
+
+    void put(size_t i, T&& value) {
+        _storage[i] = std::move(value);
+    }
+
+private:
+    Storage& _storage;
+    const Comparator& _comparator;
+};
+
+// The implementation of BinaryHeap (D = 2) and DaryHeap: a heap stored in an Array, where the
+// children of node 'i' are the D adjacent nodes starting at 'D * i + 1'
+template <typename T, unsigned D, typename Comparator>
+class heap_base {
+public:
+    heap_base(const Comparator& comparator): _array(), _comparator(comparator) {
     }
 
     /* Forbid copy and assignment */
-    BinaryHeap(const BinaryHeap&) = delete;
-    BinaryHeap(BinaryHeap&&) = delete;
-    BinaryHeap& operator =(const BinaryHeap&) = delete;
-    BinaryHeap& operator =(BinaryHeap&&) = delete;
+    heap_base(const heap_base&) = delete;
+    heap_base(heap_base&&) = delete;
+    heap_base& operator =(const heap_base&) = delete;
+    heap_base& operator =(heap_base&&) = delete;
 
     /** Initialize the heap
       * @param initial_capacity initial capacity of the heap
@@ -123,17 +257,81 @@ public:
         if (!_array.push_back(p))
             return false;
         if (++_elements > 1) {
-            _propagate_up(_elements - 1);
+            _sift_up(_elements - 1);
         }
         return true;
     }
 
+    /** Inserts a number of elements in the heap with a single critical section
+      * The elements are added at the end of the heap, then the heap is rebuilt with a bottom-up
+      * heapify (O(n)) if the new elements outnumber the old ones, otherwise each new element is
+      * moved up to its place.
+      * @param values the elements to insert
+      * @param n the number of elements to insert
+      * @returns true for success, false for failure (out of memory). If the result is false, no
+      *          element was inserted.
+      */
+    bool insert_many(const T *values, size_t n) {
+        CriticalSectionLock lock;
+        if (!_array.append(values, n))
+            return false;
+        size_t old_elements = _elements;
+        _elements = old_elements + n;
+        if (n > old_elements) {
+            _heapify();
+        } else {
+            for (size_t i = old_elements; i < _elements; i ++)
+                _sift_up(i);
+        }
+        return true;
+    }
+
+    /** Replace the contents of the heap with the elements of an array
+      * The elements are copied into the heap, then the heap is built with a bottom-up heapify
+      * (O(n)), with a single critical section.
+      * @param src the array with the new elements
+      * @returns true for success, false for failure (out of memory). If the result is false, the
+      *          heap is not changed.
+      */
+    bool build_from(const Array<T>& src) {
+        CriticalSectionLock lock;
+        if (!_prepare_build(src.get_num_elements()))
+            return false;
+        src.for_each_span([this](const T *values, size_t count) {
+            _array.append(values, count);
+        });
+        _elements = src.get_num_elements();
+        _heapify();
+        return true;
+    }
+
+    /** Replace the contents of the heap with the elements in the range [first, last)
+      * The elements are copied into the heap, then the heap is built with a bottom-up heapify
+      * (O(n)), with a single critical section.
+      * @param first iterator to the first element (a forward iterator)
+      * @param last iterator past the last element
+      * @returns true for success, false for failure (out of memory). If the result is false, the
+      *          heap is not changed.
+      */
+    template <typename ForwardIt>
+    bool build_from(ForwardIt first, ForwardIt last) {
+        CriticalSectionLock lock;
+        size_t n = std::distance(first, last);
+        if (!_prepare_build(n))
+            return false;
+        // The space was reserved by '_prepare_build', so this can't fail
+        _array.append(first, last);
+        _elements = n;
+        _heapify();
+        return true;
+    }
+
     /** Returns a copy of the element in the root of the heap
       * @returns copy of the root
       */
     T get_root() const {
         if (_elements == 0) {
-            CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty BinaryHeap");
+            CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty heap");
         }
         return _array[0];
     }
@@ -142,11 +340,11 @@ public:
       * @returns copy of the root
       */
     T pop_root() {
-         if (_elements == 0) {
-            CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty BinaryHeap");
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("pop_root() called on an empty heap");
         }
         CriticalSectionLock lock;
-        T temp = _array[0];
+        T temp = std::move(_array[0]); // element 0 is overwritten by 'remove_root()' below
         remove_root();
         return temp;
     }
@@ -159,11 +357,7 @@ public:
             return;
         {
             CriticalSectionLock lock;
-            _swap(0, --_elements); // element 0 will be destroyed by 'pop_back()' below
-            _array.pop_back();
-            if (_elements > 1) {
-                _propagate_down(0);
-            }
+            _remove_at(0);
         }
     }
 
@@ -191,10 +385,7 @@ public:
             }
             if (i == _elements)
                 return false;
-            _swap(i, --_elements); // element i will be destroyed by 'pop_back()' below
-            _array.pop_back();
-            if (_elements > 1)
-                _propagate_down(i);
+            _remove_at(i);
             return true;
         }
     }
@@ -205,12 +396,12 @@ public:
     bool is_consistent(size_t node = 0) const {
         if (node >= _elements)
             return true;
-        size_t left = _left(node), right = _right(node);
-        if ((left < _elements) && !_comparator(_array[node], _array[left]))
-            return false;
-        if ((right < _elements) && !_comparator(_array[node], _array[right]))
-            return false;
-       return is_consistent(left) && is_consistent(right);
+        size_t first = sift::first_child(node);
+        for (size_t child = first; (child < first + D) && (child < _elements); child ++) {
+            if (!_comparator(_array[node], _array[child]) || !is_consistent(child))
+                return false;
+        }
+        return true;
     }
 
     /** Returns the number of elements in the heap
@@ -221,62 +412,39 @@ public:
     }
 
 private:
-    size_t _left(size_t i) const {
-        return 2 * i + 1;
-    }
+    // The sift operations are shared with the other heaps (see heap_sift)
+    typedef heap_sift<D> sift;
+    typedef heap_values<T, Comparator, Array<T> > nodes;
 
-    size_t _right(size_t i) const {
-        return 2 * i + 2;
+    void _sift_up(size_t node) {
+        nodes n(_array, _comparator);
+        sift::up(n, node);
     }
 
-    size_t _parent(size_t i) const {
-        return (i - 1) / 2;
+    void _heapify() {
+        nodes n(_array, _comparator);
+        sift::heapify(n, _elements);
     }
 
-    void _propagate_up(size_t node) {
-        // This is called when a node is added in the last position in the heap
-        // We might need to move the node up towards the parent until the heap property
-        // is satisfied
-        size_t parent = _parent(node);
-        // Move the node up until it satisfies the heap property
-        while ((node > 0) && _comparator(_array[node], _array[parent])) {
-            _swap(node, parent);
-            node = parent;
-            parent = _parent(node);
-        }
-    }
-
-    void _propagate_down(size_t node) {
-        // This is called when an existing node is removed
-        // When that happens, it is replaced with the node at the last position in the heap
-        // Since that might make the heap inconsistent, we need to move the node down if its
-        // value does not respect the comparison function when compared with its left and
-        // right children.
-        while (true) {
-            size_t left = _left(node), right = _right(node), temp;
-            bool change_left = (left < _elements) && !_comparator(_array[node], _array[left]);
-            bool change_right = (right < _elements) && !_comparator(_array[node], _array[right]);
-            if (change_left && change_right) {
-                // If both left/right should change, use the comparison function to figure out
-                // which way to go
-                temp = _comparator(_array[left], _array[right]) ? left : right;
-            } else if (change_left) {
-                temp = left;
-            } else if (change_right) {
-                temp = right;
-            } else {
-                break;
-            }
-            _swap(node, temp);
-            node = temp;
-        }
+    bool _prepare_build(size_t n) {
+        // Make sure that 'n' elements fit in the heap (so they can be added without failure),
+        // then remove the current elements
+        if (!_array.reserve(n))
+            return false;
+        _array.clear();
+        _elements = 0;
+        return true;
     }
 
-    void _swap(size_t pos1, size_t pos2) {
-        if (pos1 != pos2) {
-            T temp = _array[pos1];
-            _array[pos1] = _array[pos2];
-            _array[pos2] = temp;
+    void _remove_at(size_t node) {
+        // The last node takes the place of 'node', then it is moved up or down as needed
+        size_t last = -- _elements;
+        if (node != last)
+            _array[node] = std::move(_array[last]);
+        _array.pop_back();
+        if (node < _elements) {
+            nodes n(_array, _comparator);
+            sift::restore(n, _elements, node);
         }
     }
 
@@ -285,6 +453,17 @@ private:
     volatile size_t _elements;
 };
 
+} // namespace detail
+
+template <typename T, typename Comparator=MinCompare<T> >
+class BinaryHeap: public detail::heap_base<T, 2, Comparator> {
+public:
+    /** Construct a new binary heap
+      */
+    BinaryHeap(const Comparator& comparator = Comparator()): detail::heap_base<T, 2, Comparator>(comparator) {
+    }
+};
+
 } // namespace util
 } // namespace mbed
 
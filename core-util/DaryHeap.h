@@ -0,0 +1,70 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_DARY_HEAP_H__
+#define __MBED_UTIL_DARY_HEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/BinaryHeap.h"
+
+namespace mbed {
+namespace util {
+
+/** A reentrant d-ary heap: like BinaryHeap, but each node has D children instead of 2.
+  *
+  * The nodes are stored in an Array with the same implicit representation as BinaryHeap: the
+  * children of node 'i' are the D adjacent nodes starting at 'D * i + 1'. A larger D makes the
+  * tree shallower (log_D(n) levels instead of log_2(n)), so inserting an element touches fewer
+  * nodes, and removing the root touches fewer levels, each of them a single group of D adjacent
+  * nodes (that fits in one or two cache lines for small elements, instead of a cache miss for each
+  * level of a binary heap). D = 4 or D = 8 usually work best for heaps with many elements.
+  *
+  * The API is the same as BinaryHeap's (both share the implementation in detail::heap_base,
+  * BinaryHeap being the D = 2 case), and so are the comparators (MinCompare/MaxCompare).
+  *
+  * Usage example:
+  *
+  * @code
+  * DaryHeap<uint32_t, 4> timeouts; // 4-ary min-heap
+  * timeouts.init(64, 64, traits);
+  * timeouts.insert(1000);
+  * uint32_t next = timeouts.pop_root();
+  * @endcode
+  */
+template <typename T, unsigned D = 4, typename Comparator = MinCompare<T> >
+class DaryHeap: public detail::heap_base<T, D, Comparator> {
+    static_assert(D >= 2, "DaryHeap needs at least 2 children per node");
+
+public:
+    /** Construct a new d-ary heap
+      */
+    DaryHeap(const Comparator& comparator = Comparator()): detail::heap_base<T, D, Comparator>(comparator) {
+    }
+
+    /** Returns the number of children of each node
+      * @returns D
+      */
+    static unsigned get_arity() {
+        return D;
+    }
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_DARY_HEAP_H__
@@ -20,6 +20,7 @@
 
 #include <stddef.h>
 #include "core-util/PoolAllocator.h"
+#include "core-util/FunctionPointer.h"
 #include "ualloc/ualloc.h"
 
 namespace mbed {
@@ -30,13 +31,41 @@ namespace util {
   * The pool allocator contains a linked list of one or more PoolAllocator instances
   *
   * ExtendablePoolAllocator starts with a single PoolAllocator. Allocation is first
-  * attempted from the most recent pool; if that fails, allocation is attempted again
-  * from the other pools. If that fails, a new pool is created (with a number of elements
-  * specified by 'set_new_pool_size' and allocation is attempted from this new pool
+  * attempted from the most recent pool; if that fails, allocation is attempted from the pools
+  * that are known to have free space. If that fails, a new pool is created (with a number of
+  * elements given by the growth policy) and allocation is attempted from this new pool. By
+  * default all new pools have the 'new_pool_elements' size given to init();
+  * set_geometric_growth() and set_growth_callback() select other policies.
+  *
+  * The pools with free space are kept in a small table: free() adds a pool to it when the pool
+  * stops being full, and alloc() removes a pool from it when the pool is found full. A flag in
+  * each pool tells if the pool is in the table, so a pool is never added twice. If the
+  * table overflows, the pools that didn't fit are counted, and alloc() refills the table with
+  * a walk over the pools that resumes where the previous walk stopped. This keeps alloc() from
+  * walking all the pools when the most recent pool is full.
+  *
+  * free() finds the pool that owns an element in O(log(number of pools)) using a skip list
+  * ordered by the pools' start addresses (https://en.wikipedia.org/wiki/Skip_list). The skip
+  * list only grows, so it can be searched and extended without locks.
+  *
+  * New pools are created without locks too: a context that runs out of space creates a pool
+  * and publishes it as the new head of the list with a CAS. If another context published a pool
+  * first, the new pool is linked on top of it, or given back if the other pool can be used.
+  *
+  * Pools that become completely empty can be given back to the system with trim() or
+  * trim_if_needed(). Trimming modifies the list of pools, so it must not run concurrently with
+  * other operations on the same allocator (in other threads or in interrupt handlers). free()
+  * never releases pools: it only counts the empty ones, so it stays safe to call from any context.
   */
 
 class ExtendablePoolAllocator {
 public:
+    /** Callback that computes the size of a new pool. Its arguments are the number of existing
+      * pools and the size (in elements) of the most recent pool; it returns the number of
+      * elements of the new pool (0 to refuse growing).
+      */
+    typedef FunctionPointer2<size_t, unsigned, size_t> GrowthCallback;
+
     /** Create a new extendable pool allocator
       */
     ExtendablePoolAllocator();
@@ -63,9 +92,37 @@ public:
       */
     bool init(size_t initial_elements, size_t new_pool_elements, size_t element_size, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN);
 
+    /** Create all new pools with the 'new_pool_elements' size given to init() (the default)
+      */
+    void set_fixed_growth();
+
+    /** Double the size of each new pool: the first new pool has 'new_pool_elements' elements
+      * (as given to init()), each of the next ones is twice as large as the most recent pool,
+      * up to 'max_pool_elements'.
+      * @param max_pool_elements maximum size of a new pool in elements
+      */
+    void set_geometric_growth(size_t max_pool_elements);
+
+    /** Compute the size of each new pool with a user supplied function (see GrowthCallback)
+      * The function is called from alloc(), possibly from several contexts at the same time.
+      * @param function the static function to call
+      */
+    void set_growth_callback(GrowthCallback::static_fp function);
+
+    /** Compute the size of each new pool with a user supplied member function (see GrowthCallback)
+      * The function is called from alloc(), possibly from several contexts at the same time.
+      * @param object the object to invoke the member function on
+      * @param member the member function to call
+      */
+    template <typename T>
+    void set_growth_callback(T *object, size_t (T::*member)(unsigned, size_t)) {
+        _growth_callback.attach(object, member);
+        _growth_policy = growth_callback;
+    }
+
     /** Allocate a new element from the pool
       * It will try to allocate using the most recent pool
-      * Failing that, it will try to allocate from all the other pools
+      * Failing that, it will try to allocate from the pools that are known to have free space
       * Failing that, it will try to create a new pool and allocate from it
       * @returns the address of the new element or NULL for error
       */
@@ -86,20 +143,114 @@ public:
       */
     unsigned get_num_pools() const;
 
+    /** Return the number of pools that don't have any allocated elements
+      * @returns number of empty pools
+      */
+    unsigned get_num_empty_pools() const;
+
+    /** Release the memory of the pools that don't have any allocated elements
+      * The most recent empty pools are kept, up to 'keep_empty' of them. The allocator always
+      * keeps at least one pool.
+      * This must not be called concurrently with any other operation on this allocator.
+      * @param keep_empty number of empty pools to keep
+      * @returns the number of pools that were released
+      */
+    unsigned trim(unsigned keep_empty = 0);
+
+    /** Configure the hysteresis used by trim_if_needed(): when more than 'high_watermark' pools
+      * are empty, trim_if_needed() releases empty pools until only 'low_watermark' of them are
+      * left. The gap between the two watermarks avoids releasing and creating pools over and over
+      * when the load oscillates.
+      * @param high_watermark number of empty pools that triggers trimming (0 disables trimming
+      *        in trim_if_needed())
+      * @param low_watermark number of empty pools to keep after trimming (must be lower than
+      *        'high_watermark')
+      */
+    void set_trim_watermarks(unsigned high_watermark, unsigned low_watermark = 0);
+
+    /** Checks if there are more empty pools than the high watermark set with set_trim_watermarks()
+      * This only reads a counter, so it can be called from any context (for example from an
+      * interrupt handler that wants to schedule trimming).
+      * @returns true if trim_if_needed() would release pools, false otherwise
+      */
+    bool needs_trim() const;
+
+    /** Release empty pools if there are more of them than the high watermark, keeping the low
+      * watermark (see set_trim_watermarks())
+      * Like trim(), this must not be called concurrently with any other operation on this allocator.
+      * @returns the number of pools that were released
+      */
+    unsigned trim_if_needed();
+
+    /** Check the consistency of the table of pools with free space: each pool in the table must
+      * be in the list of pools, be in the table only once and be flagged as such.
+      * This must not be called concurrently with any other operation on this allocator.
+      * @returns true if the table is consistent, false otherwise
+      */
+    bool is_consistent() const;
+
 private:
+    enum growth_policy_t {
+        growth_fixed,
+        growth_geometric,
+        growth_callback
+    };
+
+    // Maximum height of the skip list used for looking up pools by address
+    static const unsigned max_lookup_levels = 16;
+    // Size of the table of pools with free space
+    static const unsigned nonfull_slots = 16;
+
     struct pool_link {
-        pool_link(void *start, size_t elements, size_t element_size, unsigned alignment, pool_link *_prev):
+        pool_link(void *start, size_t _elements, size_t element_size, unsigned alignment, pool_link *_prev, unsigned _levels):
             prev(_prev),
-            allocator(start, elements, element_size, alignment) {
+            allocator(start, _elements, element_size, alignment, true),
+            elements(_elements),
+            live(0),
+            cached(0),
+            levels(_levels) {
+            for (unsigned i = 0; i < levels; i ++)
+                next[i] = NULL;
         }
 
         pool_link *prev;
         PoolAllocator allocator;
+        size_t elements;
+        // Number of elements allocated from this pool, plus the allocations in progress
+        uint32_t live;
+        // 1 if the pool is in '_nonfull' (or is being added to it)
+        uint8_t cached;
+        unsigned levels;
+        // Skip list links, ordered by start address. The actual size of this array is 'levels'
+        // (the memory for the extra links is allocated together with the pool_link)
+        pool_link *next[1];
     };
-    pool_link *create_new_pool(size_t elements, pool_link *prev) const;
+    size_t get_new_pool_elements(const pool_link *head);
+    pool_link *create_new_pool(size_t elements, pool_link *prev);
+    void *pool_alloc(pool_link *link, pool_link *volatile *slot);
+    void pool_free(pool_link *link, void *p);
+    void pool_release(pool_link *link);
+    bool nonfull_insert(pool_link *link);
+    void *nonfull_alloc();
+    void nonfull_refill();
+    void release_pool(pool_link *link, pool_link *newer);
+    void discard_pool(pool_link *link);
+    void lookup_insert(pool_link *link);
+    void lookup_remove(pool_link *link);
+    pool_link *lookup_owner(const void *p) const;
 
     pool_link *volatile _head;
-    size_t _element_size, _new_pool_elements;
+    // Pools that have (or recently had) free space. A NULL entry is a free slot.
+    pool_link *volatile _nonfull[nonfull_slots];
+    // Where the next refill of '_nonfull' starts looking for pools with free space
+    pool_link *volatile _scan_cursor;
+    pool_link *_lookup[max_lookup_levels];
+    // '_uncached' is the number of pools that had free space but didn't fit in '_nonfull'
+    uint32_t _pools_created, _empty_pools, _uncached;
+    unsigned _trim_high_watermark, _trim_low_watermark;
+    size_t _element_size, _new_pool_elements, _max_pool_elements;
+    growth_policy_t _growth_policy;
+    GrowthCallback _growth_callback;
     UAllocTraits_t _alloc_traits;
     unsigned _alignment;
 };
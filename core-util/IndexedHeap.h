@@ -0,0 +1,373 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_INDEXED_HEAP_H__
+#define __MBED_UTIL_INDEXED_HEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/Array.h"
+#include "core-util/BinaryHeap.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A reentrant binary heap with addressable elements.
+  *
+  * insert() returns a handle for the new element. The handle stays valid while the element is in
+  * the heap (even if the element moves inside the heap), and can be used to remove the element
+  * or to change its value in O(log(n)), without searching for it. This makes it a good fit for
+  * timer queues, where timeouts are often cancelled or rescheduled before they expire.
+  *
+  * The heap keeps a position table (an Array with an entry per handle) that is updated every time
+  * an element moves. The entries of removed elements are reused by later insertions, but each
+  * handle also carries a generation number that changes every time its entry is reused, so a
+  * stale handle (for example the handle of a timeout that already expired) is rejected by
+  * remove(), update_key() and contains() instead of referring to the new element. The generation
+  * has 11 bits, so a stale handle is only mistaken for a new one if its entry was reused a
+  * multiple of 2048 times in the meantime. The heap can hold up to 2^20 - 1 elements.
+  *
+  * The elements are ordered with the same comparators as BinaryHeap (MinCompare/MaxCompare).
+  *
+  * Usage example:
+  *
+  * @code
+  * IndexedHeap<uint32_t> timeouts;
+  * timeouts.init(16, 16, traits);
+  * IndexedHeap<uint32_t>::handle_t h = timeouts.insert(now + 100);
+  * timeouts.update_key(h, now + 200); // reschedule
+  * timeouts.remove(h);                // cancel
+  * @endcode
+  */
+template <typename T, typename Comparator = MinCompare<T> >
+class IndexedHeap {
+public:
+    /** Handle of an element in the heap
+      */
+    typedef uint32_t handle_t;
+
+    /** Handle returned when an element couldn't be inserted
+      */
+    static const handle_t invalid_handle = 0xFFFFFFFFUL;
+
+    /** Construct a new indexed heap
+      */
+    IndexedHeap(const Comparator& comparator = Comparator()): _nodes(), _positions(), _comparator(comparator),
+        _elements(0), _free_handle(invalid_handle) {
+    }
+
+    /* Forbid copy and assignment */
+    IndexedHeap(const IndexedHeap&) = delete;
+    IndexedHeap(IndexedHeap&&) = delete;
+    IndexedHeap& operator =(const IndexedHeap&) = delete;
+    IndexedHeap& operator =(IndexedHeap&&) = delete;
+
+    /** Initialize the heap
+      * @param initial_capacity initial capacity of the heap
+      * @param grow_capacity number of elements to add when the heap's capacity is exceeded
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @param alignment alignment of each element in the array
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
+        _elements = 0;
+        _free_handle = invalid_handle;
+        return _nodes.init(initial_capacity, grow_capacity, alloc_traits, alignment) &&
+               _positions.init(initial_capacity, grow_capacity, alloc_traits, sizeof(uint32_t));
+    }
+
+    /** Inserts an element in the heap
+      * @param p the element to insert
+      * @returns the handle of the new element, or 'invalid_handle' for failure (out of memory)
+      */
+    handle_t insert(const T& p) {
+        CriticalSectionLock lock;
+        handle_t h = _alloc_handle();
+        if (h == invalid_handle)
+            return invalid_handle;
+        if (!_nodes.push_back(node(p, h))) {
+            _free_handle_slot(h);
+            return invalid_handle;
+        }
+        size_t pos = _elements ++;
+        _set_position(h, pos);
+        heap_nodes n(*this);
+        sift::up(n, pos);
+        return h;
+    }
+
+    /** Returns a copy of the element in the root of the heap
+      * @returns copy of the root
+      */
+    T get_root() const {
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty IndexedHeap");
+        }
+        return _nodes[0].value;
+    }
+
+    /** Returns the handle of the element in the root of the heap
+      * @returns handle of the root, or 'invalid_handle' if the heap is empty
+      */
+    handle_t get_root_handle() const {
+        CriticalSectionLock lock;
+        return _elements == 0 ? invalid_handle : _nodes[0].handle;
+    }
+
+    /** Remove the root of the heap and return a copy of its value
+      * @returns copy of the root
+      */
+    T pop_root() {
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("pop_root() called on an empty IndexedHeap");
+        }
+        CriticalSectionLock lock;
+        T temp = std::move(_nodes[0].value); // node 0 is overwritten by '_remove_at()' below
+        _remove_at(0);
+        return temp;
+    }
+
+    /** Removes the element at the root of the heap, possibly re-shaping the heap
+      * to keep it consistent
+      */
+    void remove_root() {
+        if (_elements == 0)
+            return;
+        {
+            CriticalSectionLock lock;
+            _remove_at(0);
+        }
+    }
+
+    /** Remove an element from the heap
+      * @param h the handle of the element
+      * @returns true if the element was removed, false if the handle is not valid
+      */
+    bool remove(handle_t h) {
+        CriticalSectionLock lock;
+        if (!_is_live(h))
+            return false;
+        _remove_at(_get_position(h));
+        return true;
+    }
+
+    /** Change the value of an element, moving it up or down in the heap as needed
+      * @param h the handle of the element
+      * @param value the new value of the element
+      * @returns true if the element was updated, false if the handle is not valid
+      */
+    bool update_key(handle_t h, const T& value) {
+        CriticalSectionLock lock;
+        if (!_is_live(h))
+            return false;
+        size_t pos = _get_position(h);
+        _nodes[pos].value = value;
+        heap_nodes n(*this);
+        sift::restore(n, _elements, pos);
+        return true;
+    }
+
+    /** Returns a copy of an element of the heap
+      * Calling this function with an invalid handle results in a runtime error.
+      * @param h the handle of the element
+      * @returns copy of the element
+      */
+    T get(handle_t h) const {
+        CriticalSectionLock lock;
+        if (!_is_live(h)) {
+            CORE_UTIL_RUNTIME_ERROR("Attempt to use invalid handle %u in IndexedHeap %p\r\n", (unsigned)h, this);
+        }
+        return _nodes[_get_position(h)].value;
+    }
+
+    /** Checks if a handle refers to an element in the heap
+      * @param h the handle
+      * @returns true if the handle refers to an element in the heap, false otherwise
+      */
+    bool contains(handle_t h) const {
+        CriticalSectionLock lock;
+        return _is_live(h);
+    }
+
+    /** Checks if the heap is empty
+      * @returns true if the heap is empty, false otherwise
+      */
+    bool is_empty() const {
+        return _elements == 0;
+    }
+
+    /** Check the heap's consistency by applying the user supplied comparison function to its
+      * nodes, and check that the position of each node is known
+      * @returns true if the heap is consistent, false otherwise
+      */
+    bool is_consistent() const {
+        for (size_t pos = 0; pos < _elements; pos ++) {
+            if ((pos > 0) && !_comparator(_nodes[sift::parent(pos)].value, _nodes[pos].value))
+                return false;
+            if (!_is_live(_nodes[pos].handle) || (_get_position(_nodes[pos].handle) != pos))
+                return false;
+        }
+        return true;
+    }
+
+    /** Returns the number of elements in the heap
+      * @returns number of elements in the heap
+      */
+    size_t get_num_elements() const {
+        return _elements;
+    }
+
+private:
+    struct node {
+        node(const T& v, handle_t h): value(v), handle(h) {}
+
+        T value;
+        handle_t handle;
+    };
+
+    // A handle is made of the index of its entry in '_positions' (low bits) and of the generation
+    // of the entry (high bits). An entry holds the generation and the position of its element, or,
+    // if the entry doesn't belong to an element in the heap, the generation and the index of the
+    // next free entry (the free entries are linked in a list), tagged with 'free_flag'.
+    static const unsigned index_bits = 20;
+    static const uint32_t index_mask = (1UL << index_bits) - 1;
+    static const uint32_t generation_mask = 0x7FFFFFFFUL & ~index_mask;
+    static const uint32_t free_flag = 0x80000000UL;
+
+    bool _is_live(handle_t h) const {
+        uint32_t idx = h & index_mask;
+        if ((h & free_flag) || (idx >= _positions.get_num_elements()))
+            return false;
+        uint32_t entry = _positions[idx];
+        return ((entry & free_flag) == 0) && ((entry & generation_mask) == (h & generation_mask));
+    }
+
+    size_t _get_position(handle_t h) const {
+        return _positions[h & index_mask] & index_mask;
+    }
+
+    void _set_position(handle_t h, size_t pos) {
+        _positions[h & index_mask] = (h & generation_mask) | (uint32_t)pos;
+    }
+
+    handle_t _alloc_handle() {
+        uint32_t idx;
+        if (_free_handle != invalid_handle) {
+            idx = _free_handle;
+            uint32_t next = _positions[idx] & index_mask;
+            _free_handle = next == index_mask ? invalid_handle : next;
+        } else {
+            idx = _positions.get_num_elements();
+            // The last index is reserved for the end of the free list
+            if ((idx >= index_mask) || !_positions.push_back(0))
+                return invalid_handle;
+        }
+        handle_t h = (_positions[idx] & generation_mask) | idx;
+        _set_position(h, 0);
+        return h;
+    }
+
+    void _free_handle_slot(handle_t h) {
+        // The next handle that uses this entry gets a new generation
+        uint32_t idx = h & index_mask;
+        uint32_t generation = (h + (1UL << index_bits)) & generation_mask;
+        _positions[idx] = free_flag | generation | (_free_handle == invalid_handle ? index_mask : _free_handle);
+        _free_handle = idx;
+    }
+
+    typedef detail::heap_sift<2> sift;
+
+    // 'Nodes' for detail::heap_sift: every node that moves gets its position updated
+    class heap_nodes {
+    public:
+        typedef node node_type;
+
+        heap_nodes(IndexedHeap& heap): _heap(heap) {
+        }
+
+        const T& key(size_t i) const {
+            return _heap._nodes[i].value;
+        }
+
+        static const T& key_of(const node& n) {
+            return n.value;
+        }
+
+        bool compare(const T& e1, const T& e2) const {
+            return _heap._comparator(e1, e2);
+        }
+
+        node take(size_t i) {
+            return std::move(_heap._nodes[i]);
+        }
+
+        void move(size_t to, size_t from) {
+            put(to, std::move(_heap._nodes[from]));
+        }
+
+        void put(size_t i, node&& n) {
+            _heap._set_position(n.handle, i);
+            _heap._nodes[i] = std::move(n);
+        }
+
+    private:
+        IndexedHeap& _heap;
+    };
+
+    void _remove_at(size_t pos) {
+        // The last node takes the place of 'pos', then it is moved up or down as needed
+        _free_handle_slot(_nodes[pos].handle);
+        size_t last = -- _elements;
+        heap_nodes n(*this);
+        if (pos != last)
+            n.move(pos, last);
+        _nodes.pop_back();
+        if (pos < _elements)
+            sift::restore(n, _elements, pos);
+    }
+
+    Array<node> _nodes;
+    // Generation and position in '_nodes' of each handle
+    Array<uint32_t> _positions;
+    Comparator _comparator;
+    volatile size_t _elements;
+    // Index of the first free entry in '_positions'
+    uint32_t _free_handle;
+};
+
+template <typename T, typename Comparator>
+const typename IndexedHeap<T, Comparator>::handle_t IndexedHeap<T, Comparator>::invalid_handle;
+
+template <typename T, typename Comparator>
+const unsigned IndexedHeap<T, Comparator>::index_bits;
+
+template <typename T, typename Comparator>
+const uint32_t IndexedHeap<T, Comparator>::index_mask;
+
+template <typename T, typename Comparator>
+const uint32_t IndexedHeap<T, Comparator>::generation_mask;
+
+template <typename T, typename Comparator>
+const uint32_t IndexedHeap<T, Comparator>::free_flag;
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_INDEXED_HEAP_H__
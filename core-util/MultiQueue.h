@@ -0,0 +1,355 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_MULTI_QUEUE_H__
+#define __MBED_UTIL_MULTI_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+#include "core-util/atomic_ops.h"
+#include "core-util/BinaryHeap.h"
+#include "core-util/cache_line.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A concurrent, relaxed priority queue for many producers and consumers (a "MultiQueue").
+  *
+  * The elements are spread over a number of independent sub-queues (binary heaps), each protected
+  * by its own flag. insert() adds the element to a randomly chosen sub-queue; pop() looks at the
+  * roots of two randomly chosen sub-queues and removes the better one. A context that finds a
+  * sub-queue busy simply picks another one, so there are no critical sections and no context ever
+  * waits for a flag held by another context. insert() and pop() give up (and return false) after a
+  * bounded number of attempts if all the sub-queues they try stay busy: this can only happen when
+  * other contexts hold the sub-queues, for example in an interrupt handler that interrupted a
+  * thread in the middle of an operation on a queue with a single sub-queue. Interrupt handlers
+  * should use queues with at least two sub-queues per context that can use the queue at the same
+  * time, so that they always find a free sub-queue.
+  *
+  * The ordering is relaxed: pop() doesn't always return the best element in the queue, but one
+  * of the best elements (usually among the first few times the number of sub-queues). With a
+  * single sub-queue, the MultiQueue is a strict priority queue. About twice as many sub-queues as
+  * concurrent threads is usually a good choice.
+  *
+  * The elements are sorted with the same comparators as BinaryHeap (MinCompare/MaxCompare).
+  *
+  * Usage example:
+  *
+  * @code
+  * MultiQueue<uint32_t> jobs;
+  * jobs.init(8, 64, 64, traits); // 8 sub-queues
+  *
+  * void worker() {
+  *     uint32_t job;
+  *     while (jobs.pop(job)) {
+  *         ...
+  *     }
+  * }
+  * @endcode
+  */
+template <typename T, typename Comparator = MinCompare<T> >
+class MultiQueue {
+public:
+    /** Construct a new multi-queue
+      */
+    MultiQueue(const Comparator& comparator = Comparator()): _queues(NULL), _num_queues(0), _stride(0),
+        _grow_capacity(0), _alloc_traits(), _ticket(0), _comparator(comparator) {
+    }
+
+    /* Forbid copy and assignment */
+    MultiQueue(const MultiQueue&) = delete;
+    MultiQueue(MultiQueue&&) = delete;
+    MultiQueue& operator =(const MultiQueue&) = delete;
+    MultiQueue& operator =(MultiQueue&&) = delete;
+
+    /** Destructor. It destroys all the elements and releases all the memory of the queue
+      */
+    ~MultiQueue() {
+        for (unsigned i = 0; i < _num_queues; i ++)
+            _get_queue(i)->~sub_queue();
+        mbed_ufree(_queues);
+    }
+
+    /** Initialize the queue
+      * @param num_queues number of sub-queues (at least 1)
+      * @param initial_capacity initial capacity of each sub-queue
+      * @param grow_capacity number of elements to add to a sub-queue when its capacity is exceeded
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(unsigned num_queues, size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits) {
+        if ((_queues != NULL) || (num_queues == 0))
+            return false;
+        // Each sub-queue takes a whole number of cache lines, so the sub-queues don't share cache lines
+        size_t stride = (sizeof(sub_queue) + MBED_UTIL_CACHE_LINE_SIZE - 1) / MBED_UTIL_CACHE_LINE_SIZE * MBED_UTIL_CACHE_LINE_SIZE;
+        void *queues = mbed_ualloc(stride * num_queues + MBED_UTIL_CACHE_LINE_SIZE, alloc_traits);
+        if (queues == NULL)
+            return false;
+        _queues = queues;
+        _stride = stride;
+        _alloc_traits = alloc_traits;
+        _grow_capacity = grow_capacity;
+        for (unsigned i = 0; i < num_queues; i ++) {
+            sub_queue *q = new(_get_queue_storage(i)) sub_queue();
+            if ((initial_capacity > 0) && !q->grow(initial_capacity, _alloc_traits)) {
+                // Out of memory: release everything
+                for (unsigned j = 0; j <= i; j ++)
+                    _get_queue(j)->~sub_queue();
+                mbed_ufree(_queues);
+                _queues = NULL;
+                return false;
+            }
+        }
+        _num_queues = num_queues;
+        return true;
+    }
+
+    /** Inserts an element in the queue
+      * @param p the element to insert
+      * @returns true for success, false for failure (out of memory/uninitialized, or other contexts
+      *          kept all the sub-queues busy for too long, see the class description)
+      */
+    bool insert(const T& p) {
+        if (_num_queues == 0)
+            return false;
+        sub_queue *q = _lock_any_queue();
+        if (q == NULL)
+            return false;
+        bool res = true;
+        if (q->elements == q->capacity)
+            res = (_grow_capacity > 0) && q->grow(q->capacity + _grow_capacity, _alloc_traits);
+        if (res)
+            q->push(p, _comparator);
+        q->unlock();
+        return res;
+    }
+
+    /** Removes one of the best elements of the queue (see the class description)
+      * @param p receives the removed element
+      * @returns true if an element was removed, false if the queue is empty. While other contexts
+      *          work on the queue, false might also mean that they kept all the non-empty
+      *          sub-queues busy for too long.
+      */
+    bool pop(T& p) {
+        if (_num_queues == 0)
+            return false;
+        // Look at the roots of two random sub-queues and take the better one
+        for (unsigned attempt = 0; attempt < 2 * _num_queues; attempt ++) {
+            sub_queue *q1 = _get_queue(_random() % _num_queues);
+            if ((q1->elements == 0) || !q1->try_lock())
+                continue;
+            sub_queue *q2 = _get_queue(_random() % _num_queues);
+            if ((q2 != q1) && (q2->elements > 0) && q2->try_lock()) {
+                if ((q2->elements > 0) && ((q1->elements == 0) || !_comparator(q1->data[0], q2->data[0])))
+                    std::swap(q1, q2);
+                q2->unlock();
+            }
+            if (q1->elements > 0) {
+                q1->pop(p, _comparator);
+                q1->unlock();
+                return true;
+            }
+            q1->unlock();
+        }
+        // Most sub-queues look empty: check all of them
+        for (unsigned pass = 0; pass < 4; pass ++) {
+            bool busy = false;
+            for (unsigned i = 0; i < _num_queues; i ++) {
+                sub_queue *q = _get_queue(i);
+                if (q->elements == 0)
+                    continue;
+                if (!q->try_lock()) {
+                    busy = true;
+                    continue;
+                }
+                if (q->elements > 0) {
+                    q->pop(p, _comparator);
+                    q->unlock();
+                    return true;
+                }
+                q->unlock();
+            }
+            if (!busy)
+                break;
+        }
+        return false;
+    }
+
+    /** Checks if the queue is empty. When other contexts work on the queue, the result is only a
+      * snapshot.
+      * @returns true if the queue is empty, false otherwise
+      */
+    bool is_empty() const {
+        return get_num_elements() == 0;
+    }
+
+    /** Returns the number of elements in the queue. When other contexts work on the queue, the
+      * result is only a snapshot.
+      * @returns number of elements in the queue
+      */
+    size_t get_num_elements() const {
+        size_t total = 0;
+        for (unsigned i = 0; i < _num_queues; i ++)
+            total += _get_queue(i)->elements;
+        return total;
+    }
+
+    /** Returns the number of sub-queues
+      * @returns number of sub-queues
+      */
+    unsigned get_num_queues() const {
+        return _num_queues;
+    }
+
+    /** Check the consistency of all the sub-queues by applying the user supplied comparison
+      * function to their nodes. This function must not be called concurrently with other functions
+      * that change the queue.
+      * @returns true if all the sub-queues are consistent, false otherwise
+      */
+    bool is_consistent() const {
+        for (unsigned i = 0; i < _num_queues; i ++) {
+            const sub_queue *q = _get_queue(i);
+            for (size_t node = 1; node < q->elements; node ++) {
+                if (!_comparator(q->data[sift::parent(node)], q->data[node]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // The sub-queues use the same sift operations as BinaryHeap (see detail::heap_sift)
+    typedef detail::heap_sift<2> sift;
+    typedef detail::heap_values<T, Comparator, T*> nodes;
+
+    // A binary heap in a single memory area, protected by a flag. All the functions except
+    // 'try_lock' must be called by the context that holds the flag.
+    struct sub_queue {
+        sub_queue(): locked(0), elements(0), capacity(0), data(NULL) {}
+
+        ~sub_queue() {
+            for (size_t i = 0; i < elements; i ++)
+                data[i].~T();
+            mbed_ufree(data);
+        }
+
+        bool try_lock() {
+            uint8_t expected = 0;
+            return atomic_cas((uint8_t*)&locked, &expected, (uint8_t)1);
+        }
+
+        void unlock() {
+            uint8_t expected = 1;
+            atomic_cas((uint8_t*)&locked, &expected, (uint8_t)0);
+        }
+
+        // Move the elements to a new memory area with space for 'new_capacity' elements
+        bool grow(size_t new_capacity, UAllocTraits_t alloc_traits) {
+            T *new_data = (T*)mbed_ualloc(new_capacity * sizeof(T), alloc_traits);
+            if (new_data == NULL)
+                return false;
+            for (size_t i = 0; i < elements; i ++) {
+                new(new_data + i) T(std::move(data[i]));
+                data[i].~T();
+            }
+            mbed_ufree(data);
+            data = new_data;
+            capacity = new_capacity;
+            return true;
+        }
+
+        void push(const T& value, const Comparator& comparator) {
+            new(data + elements) T(value);
+            nodes n(data, comparator);
+            sift::up(n, elements);
+            elements = elements + 1;
+        }
+
+        void pop(T& value, const Comparator& comparator) {
+            // The last element takes the place of the root, then it is moved down
+            value = std::move(data[0]);
+            size_t last = elements - 1;
+            if (last > 0)
+                data[0] = std::move(data[last]);
+            data[last].~T();
+            elements = last;
+            nodes n(data, comparator);
+            sift::down(n, last, 0);
+        }
+
+        volatile uint8_t locked;
+        volatile size_t elements;
+        size_t capacity;
+        T *data;
+    };
+
+    // Lock a random sub-queue. Returns NULL if all the sub-queues stayed busy.
+    sub_queue *_lock_any_queue() {
+        for (unsigned attempt = 0; attempt < 2 * _num_queues; attempt ++) {
+            sub_queue *q = _get_queue(_random() % _num_queues);
+            if (q->try_lock())
+                return q;
+        }
+        // Most sub-queues look busy: check all of them, like pop()
+        for (unsigned pass = 0; pass < 4; pass ++) {
+            for (unsigned i = 0; i < _num_queues; i ++) {
+                sub_queue *q = _get_queue(i);
+                if (q->try_lock())
+                    return q;
+            }
+        }
+        return NULL;
+    }
+
+    void *_get_queue_storage(unsigned idx) const {
+        // The first sub-queue starts at the first cache line boundary in the allocated memory
+        uintptr_t start = ((uintptr_t)_queues + MBED_UTIL_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(MBED_UTIL_CACHE_LINE_SIZE - 1);
+        return (void*)(start + idx * _stride);
+    }
+
+    sub_queue *_get_queue(unsigned idx) const {
+        return (sub_queue*)_get_queue_storage(idx);
+    }
+
+    // A pseudo-random number: a counter shared by all the contexts, scrambled with the finalizer
+    // of MurmurHash3 (so consecutive calls, even from different contexts, give unrelated numbers)
+    uint32_t _random() {
+        uint32_t x = atomic_incr(&_ticket, (uint32_t)0x9E3779B9UL);
+        x ^= x >> 16;
+        x *= 0x85EBCA6BUL;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35UL;
+        x ^= x >> 16;
+        return x;
+    }
+
+    void *_queues;
+    unsigned _num_queues;
+    size_t _stride;
+    size_t _grow_capacity;
+    UAllocTraits_t _alloc_traits;
+    uint32_t _ticket;
+    Comparator _comparator;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_MULTI_QUEUE_H__
@@ -33,6 +33,14 @@ namespace util {
 /** A simple pool allocator class. It can allocate one elements oe 'element_size' bytes at a time.
   * alloc() and free() operations are synchronized, they can be used safely from both user
   * and interrupt context.
+  *
+  * The pool can be initialized lazily: in this mode the constructor doesn't touch the pool
+  * memory. Elements that were never allocated are taken from a "high water mark" that moves
+  * towards the end of the pool, and only freed elements are kept in the free list.
+  *
+  * The free list head is a tagged value: the offset of the first free block is packed together
+  * with a generation counter that changes on every update of the list, so alloc() can't be
+  * fooled by a block that was removed and put back while it was reading the list (ABA problem).
   */
 class PoolAllocator {
 public:
@@ -42,8 +50,10 @@ public:
       * @param element_size size of each pool element in bytes (this might be rounded up
                to satisfy the 'alignment' argument)
       * @param alignment allocation alignment in bytes (must be a power of 2, at least 4)
+      * @param lazy_init if true, don't link the pool elements in the constructor; elements are
+               handed out from a high water mark when the free list is empty
       */
-    PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN);
+    PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, bool lazy_init = false);
 
     /* Forbid copy and assignment */
     PoolAllocator(const PoolAllocator&) = delete;
@@ -61,11 +71,26 @@ public:
       */
    void *calloc();
 
+    /** Allocate up to 'n' elements from the pool with a single update of the free list
+      * @param out array that receives the addresses of the new elements
+      * @param n the number of elements to allocate
+      * @returns the number of elements actually allocated (less than 'n' if the pool doesn't
+      *          have enough free elements)
+      */
+    size_t alloc_n(void **out, size_t n);
+
     /** Free a previously allocated element
       * @param p pointer to element
       */
     void free(void* p);
 
+    /** Free a number of previously allocated elements with a single update of the free list
+      * Pointers that are not owned by this pool are ignored.
+      * @param in array with the addresses of the elements to free
+      * @param n the number of elements in 'in'
+      */
+    void free_n(void **in, size_t n);
+
     /** Returns a pool size suitable to hold the required number of elements
       * @param elements the size of pool in elements (each of element_size bytes)
       * @param element_size size of each pool element in bytes (this might be rounded up
@@ -94,10 +119,29 @@ public:
     void* get_start_address() const;
 
 private:
-    void _init();
-
-    void *_start, *_free_block, *_end;
+#if UINTPTR_MAX > 0xFFFFFFFFUL
+    typedef uint64_t free_list_head_t;
+#else
+    typedef uint32_t free_list_head_t;
+#endif
+
+    void _init(bool lazy_init);
+    void *_alloc_untouched();
+    size_t _alloc_n_untouched(void **out, size_t n);
+    void *_get_block(uint32_t offset) const;
+    bool _is_valid_offset(uint32_t offset) const;
+    uint32_t _get_offset(const void *p) const;
+    uint32_t _get_head_offset(free_list_head_t head) const;
+    free_list_head_t _make_head(uint32_t offset, free_list_head_t prev_head) const;
+
+    void *_start, *_end;
+    // Offset of the first free block (lower '_offset_bits' bits) and generation counter (all the other bits)
+    free_list_head_t _free_head;
     size_t _element_size;
+    unsigned _offset_bits, _offset_shift;
+    uint32_t _max_offset;
+    // Offset of the first element that was never allocated (past '_max_offset' if none)
+    uint32_t _untouched;
 };
 
 } // namespace util
@@ -0,0 +1,154 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
+#define __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/PoolAllocator.h"
+
+namespace mbed {
+namespace util {
+
+/** A magazine (small private cache of free blocks) in front of a shared PoolAllocator.
+  *
+  * Each thread (or interrupt context) that allocates from a shared pool can use its own
+  * magazine. alloc() and free() work on the magazine's stack of blocks and don't touch any
+  * memory shared with other contexts, unless the magazine is empty (then 'batch' blocks are
+  * taken from the pool) or full (then 'batch' blocks are given back to the pool). Each refill
+  * or flush is a single update of the pool's free list (see PoolAllocator::alloc_n/free_n).
+  *
+  * A magazine is NOT reentrant: it must only be used from a single context. Blocks can be freed
+  * with a different magazine (or directly to the pool) than the one used to allocate them.
+  *
+  * Usage example:
+  *
+  * @code
+  * PoolAllocator pool(storage, elements, element_size);
+  *
+  * void thread_main() {
+  *     PoolAllocatorMagazine<16> magazine(pool);
+  *     void *p = magazine.alloc();
+  *     ...
+  *     magazine.free(p);
+  * } // the magazine gives all its blocks back to the pool when it is destroyed
+  * @endcode
+  */
+template <unsigned Capacity = 16>
+class PoolAllocatorMagazine {
+public:
+    /** Create a new magazine
+      * @param pool the pool used to refill the magazine and to flush blocks to
+      * @param batch the number of blocks moved between the magazine and the pool on refill or
+      *        flush (between 1 and 'Capacity'; 0 or a larger value selects ('Capacity' + 1) / 2)
+      */
+    PoolAllocatorMagazine(PoolAllocator& pool, unsigned batch = 0):
+        _pool(pool), _count(0), _refills(0), _flushes(0) {
+        if ((batch == 0) || (batch > Capacity))
+            batch = (Capacity + 1) / 2;
+        _batch = batch;
+    }
+
+    /* Forbid copy and assignment */
+    PoolAllocatorMagazine(const PoolAllocatorMagazine&) = delete;
+    PoolAllocatorMagazine(PoolAllocatorMagazine&&) = delete;
+    PoolAllocatorMagazine& operator =(const PoolAllocatorMagazine&) = delete;
+    PoolAllocatorMagazine& operator =(PoolAllocatorMagazine&&) = delete;
+
+    /** Destructor. It gives all the cached blocks back to the pool
+      */
+    ~PoolAllocatorMagazine() {
+        flush();
+    }
+
+    /** Allocate a new element, refilling the magazine from the pool if needed
+      * @returns the address of the new element or NULL for error
+      */
+    void *alloc() {
+        if ((_count == 0) && !_refill())
+            return NULL;
+        return _blocks[-- _count];
+    }
+
+    /** Free a previously allocated element, flushing part of the magazine to the pool if needed
+      * @param p pointer to element
+      */
+    void free(void *p) {
+        if (!_pool.owns(p))
+            return;
+        if (_count == Capacity)
+            _flush(_batch);
+        _blocks[_count ++] = p;
+    }
+
+    /** Give all the cached blocks back to the pool
+      */
+    void flush() {
+        if (_count > 0)
+            _flush(_count);
+    }
+
+    /** Returns the number of blocks currently cached in the magazine
+      * @returns number of cached blocks
+      */
+    unsigned get_num_cached() const {
+        return _count;
+    }
+
+    /** Returns the number of times the magazine was refilled from the pool
+      * @returns number of refills
+      */
+    uint32_t get_refill_count() const {
+        return _refills;
+    }
+
+    /** Returns the number of times blocks were flushed from the magazine to the pool
+      * @returns number of flushes
+      */
+    uint32_t get_flush_count() const {
+        return _flushes;
+    }
+
+private:
+    bool _refill() {
+        _count = _pool.alloc_n(_blocks, _batch);
+        if (_count == 0)
+            return false;
+        _refills ++;
+        return true;
+    }
+
+    void _flush(unsigned n) {
+        // Give back the blocks at the bottom of the stack (the least recently used ones)
+        _pool.free_n(_blocks, n);
+        for (unsigned i = n; i < _count; i ++)
+            _blocks[i - n] = _blocks[i];
+        _count -= n;
+        _flushes ++;
+    }
+
+    PoolAllocator& _pool;
+    void *_blocks[Capacity];
+    unsigned _count, _batch;
+    uint32_t _refills, _flushes;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
@@ -0,0 +1,351 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_SPSC_RING_BUFFER_H__
+#define __MBED_UTIL_SPSC_RING_BUFFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "core-util/atomic_ops.h"
+#include "core-util/cache_line.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A fixed capacity, lock-free, single-producer/single-consumer ring buffer (FIFO).
+  *
+  * One context (a thread or an interrupt handler) adds elements with push()/push_n() and another
+  * context removes them with pop()/pop_n(), without locks or read-modify-write operations: each
+  * side only writes its own index, and publishes it with atomic_store_release() after the elements
+  * were written (or read). The other side reads it with atomic_load_acquire(). These use memory
+  * barriers on ARMv7-M and above and the compiler's atomic builtins on POSIX targets, so the two
+  * sides can run on different cores; on other targets they use a short critical section, which is
+  * only enough for single-core targets.
+  * The producer's and the consumer's indices are kept on different cache lines, and each side keeps
+  * a private copy of the other side's index, which is only refreshed when it doesn't show enough
+  * free slots (producer) or elements (consumer). push_n()/pop_n() move a whole batch of elements with a single
+  * index update.
+  *
+  * The capacity must be a power of 2. The storage for the elements is either allocated with
+  * mbed_ualloc or given by the user (see get_storage_size()).
+  *
+  * The ring buffer is NOT safe for more than one producer or more than one consumer.
+  *
+  * Usage example:
+  *
+  * @code
+  * SPSCRingBuffer<uint16_t> samples;
+  * samples.init(64, traits);
+  *
+  * void adc_irq() {         // producer
+  *     samples.push(read_adc());
+  * }
+  *
+  * void thread_main() {     // consumer
+  *     uint16_t buf[16];
+  *     size_t n = samples.pop_n(buf, 16);
+  *     ...
+  * }
+  * @endcode
+  */
+template <typename T>
+class SPSCRingBuffer {
+public:
+    /** Create a new ring buffer
+      */
+    SPSCRingBuffer(): _storage(NULL), _capacity(0), _mask(0), _owns_storage(false),
+        _tail(0), _write_idx(0), _head_cache(0), _head(0), _read_idx(0), _tail_cache(0) {
+    }
+
+    /* Forbid copy and assignment */
+    SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+    SPSCRingBuffer(SPSCRingBuffer&&) = delete;
+    SPSCRingBuffer& operator =(const SPSCRingBuffer&) = delete;
+    SPSCRingBuffer& operator =(SPSCRingBuffer&&) = delete;
+
+    /** Destructor. It destroys the elements still in the buffer and frees the storage
+      * (if it was allocated by the ring buffer)
+      */
+    ~SPSCRingBuffer() {
+        for (uint32_t idx = _read_idx; idx != _write_idx; idx ++)
+            _get_slot(idx)->~T();
+        if (_owns_storage)
+            mbed_ufree(_storage);
+    }
+
+    /** Initialize the ring buffer, allocating its storage with mbed_ualloc
+      * @param capacity the maximum number of elements in the buffer (a power of 2)
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t capacity, UAllocTraits_t alloc_traits) {
+        if ((_storage != NULL) || !_is_valid_capacity(capacity))
+            return false;
+        void *storage = mbed_ualloc(get_storage_size(capacity), alloc_traits);
+        if (storage == NULL)
+            return false;
+        _init(capacity, storage);
+        _owns_storage = true;
+        return true;
+    }
+
+    /** Initialize the ring buffer with storage given by the user
+      * @param capacity the maximum number of elements in the buffer (a power of 2)
+      * @param storage memory for the elements (at least 'get_storage_size(capacity)' bytes, aligned for T).
+      *        It must stay valid as long as the ring buffer is used.
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t capacity, void *storage) {
+        if ((_storage != NULL) || (storage == NULL) || !_is_valid_capacity(capacity))
+            return false;
+        _init(capacity, storage);
+        return true;
+    }
+
+    /** Adds an element at the end of the buffer (producer only)
+      * @param value the element to add
+      * @returns true if the element was added, false if the buffer is full (or not initialized)
+      */
+    bool push(const T& value) {
+        if (_free_space(1) == 0)
+            return false;
+        new(_get_slot(_write_idx)) T(value);
+        _publish_tail(1);
+        return true;
+    }
+
+    /** Adds an element at the end of the buffer by moving it (producer only)
+      * @param value the element to add
+      * @returns true if the element was added, false if the buffer is full (or not initialized)
+      */
+    bool push(T&& value) {
+        if (_free_space(1) == 0)
+            return false;
+        new(_get_slot(_write_idx)) T(std::move(value));
+        _publish_tail(1);
+        return true;
+    }
+
+    /** Adds up to 'n' elements at the end of the buffer, with a single update of the producer index
+      * (producer only)
+      * @param values the elements to add
+      * @param n the number of elements in 'values'
+      * @returns the number of elements actually added (less than 'n' if the buffer is full)
+      */
+    size_t push_n(const T *values, size_t n) {
+        uint32_t space = _free_space(n);
+        if (n > space)
+            n = space;
+        if (n == 0)
+            return 0;
+        // The elements go in at most two spans: up to the end of the storage, then from its start
+        uint32_t idx = _write_idx & _mask;
+        size_t first = _capacity - idx < n ? _capacity - idx : n;
+        _copy_in(_get_slot(_write_idx), values, first);
+        _copy_in(_get_slot(0), values + first, n - first);
+        _publish_tail(n);
+        return n;
+    }
+
+    /** Removes the element at the start of the buffer (consumer only)
+      * @param value receives the removed element
+      * @returns true if an element was removed, false if the buffer is empty (or not initialized)
+      */
+    bool pop(T& value) {
+        if (_available(1) == 0)
+            return false;
+        T *slot = _get_slot(_read_idx);
+        value = std::move(*slot);
+        slot->~T();
+        _publish_head(1);
+        return true;
+    }
+
+    /** Removes up to 'n' elements from the start of the buffer, with a single update of the consumer
+      * index (consumer only)
+      * @param values receives the removed elements
+      * @param n the maximum number of elements to remove
+      * @returns the number of elements actually removed (less than 'n' if the buffer doesn't have
+      *          enough elements)
+      */
+    size_t pop_n(T *values, size_t n) {
+        uint32_t available = _available(n);
+        if (n > available)
+            n = available;
+        if (n == 0)
+            return 0;
+        uint32_t idx = _read_idx & _mask;
+        size_t first = _capacity - idx < n ? _capacity - idx : n;
+        _move_out(values, _get_slot(_read_idx), first);
+        _move_out(values + first, _get_slot(0), n - first);
+        _publish_head(n);
+        return n;
+    }
+
+    /** Returns the element at the start of the buffer, without removing it (consumer only)
+      * @returns pointer to the first element, or NULL if the buffer is empty
+      */
+    T *front() {
+        return _available(1) == 0 ? NULL : _get_slot(_read_idx);
+    }
+
+    /** Returns the number of elements in the buffer. When called while the other side is active,
+      * the result is only a snapshot.
+      * @returns number of elements
+      */
+    size_t get_num_elements() const {
+        return _load(&_tail) - _load(&_head);
+    }
+
+    /** Checks if the buffer is empty (see get_num_elements())
+      * @returns true if the buffer is empty, false otherwise
+      */
+    bool is_empty() const {
+        return get_num_elements() == 0;
+    }
+
+    /** Checks if the buffer is full (see get_num_elements())
+      * @returns true if the buffer is full, false otherwise
+      */
+    bool is_full() const {
+        return get_num_elements() == _capacity;
+    }
+
+    /** Returns the capacity of the buffer
+      * @returns the maximum number of elements in the buffer
+      */
+    size_t get_capacity() const {
+        return _capacity;
+    }
+
+    /** Returns the size of the storage needed by a ring buffer
+      * @param capacity the maximum number of elements in the buffer
+      * @returns the size of the storage in bytes
+      */
+    static constexpr size_t get_storage_size(size_t capacity) {
+        return capacity * sizeof(T);
+    }
+
+private:
+    static bool _is_valid_capacity(size_t capacity) {
+        // The indices run freely over the whole uint32_t range, so the capacity must divide 2^32
+        return (capacity > 0) && (capacity <= 0x80000000UL) && ((capacity & (capacity - 1)) == 0);
+    }
+
+    void _init(size_t capacity, void *storage) {
+        _storage = (T*)storage;
+        _capacity = capacity;
+        _mask = capacity - 1;
+    }
+
+    T *_get_slot(uint32_t idx) const {
+        return _storage + (idx & _mask);
+    }
+
+    // Read an index written by the other side (acquire: the accesses to the elements that follow
+    // can't be moved before it)
+    static uint32_t _load(const volatile uint32_t *p) {
+        return atomic_load_acquire((uint32_t*)p);
+    }
+
+    // Publish a new value of this side's index (release: the accesses to the elements before it
+    // can't be moved after it)
+    static void _store(volatile uint32_t *p, uint32_t value) {
+        atomic_store_release((uint32_t*)p, value);
+    }
+
+    // Number of free slots seen by the producer (the consumer's index is re-read only if the
+    // cached copy says that there are fewer than 'needed' free slots)
+    uint32_t _free_space(size_t needed) {
+        uint32_t space = _capacity - (_write_idx - _head_cache);
+        if (space < needed) {
+            _head_cache = _load(&_head);
+            space = _capacity - (_write_idx - _head_cache);
+        }
+        return space;
+    }
+
+    // Number of elements seen by the consumer (the producer's index is re-read only if the
+    // cached copy says that there are fewer than 'needed' elements)
+    uint32_t _available(size_t needed) {
+        uint32_t available = _tail_cache - _read_idx;
+        if (available < needed) {
+            _tail_cache = _load(&_tail);
+            available = _tail_cache - _read_idx;
+        }
+        return available;
+    }
+
+    void _publish_tail(size_t n) {
+        _write_idx += n;
+        _store(&_tail, _write_idx);
+    }
+
+    void _publish_head(size_t n) {
+        _read_idx += n;
+        _store(&_head, _read_idx);
+    }
+
+    static void _copy_in(T *dest, const T *src, size_t n) {
+        if (std::is_trivially_copyable<T>::value) {
+            memcpy((void*)dest, (const void*)src, n * sizeof(T));
+        } else {
+            for (size_t i = 0; i < n; i ++)
+                new(dest + i) T(src[i]);
+        }
+    }
+
+    static void _move_out(T *dest, T *src, size_t n) {
+        if (std::is_trivially_copyable<T>::value) {
+            memcpy((void*)dest, (const void*)src, n * sizeof(T));
+        } else {
+            for (size_t i = 0; i < n; i ++) {
+                dest[i] = std::move(src[i]);
+                src[i].~T();
+            }
+        }
+    }
+
+    // The object isn't aligned to a cache line (it can be allocated anywhere), so a whole cache
+    // line of padding separates each group of fields from the next one: the two groups of
+    // fields are then always on different cache lines, whatever the address of the object.
+
+    // Read-only after initialization (shared by both sides)
+    T *_storage;
+    size_t _capacity;
+    uint32_t _mask;
+    bool _owns_storage;
+    uint8_t _pad0[MBED_UTIL_CACHE_LINE_SIZE];
+    // Producer side: its published index, its private copy of it and its copy of the consumer's index
+    volatile uint32_t _tail;
+    uint32_t _write_idx, _head_cache;
+    uint8_t _pad1[MBED_UTIL_CACHE_LINE_SIZE];
+    // Consumer side: its published index, its private copy of it and its copy of the producer's index
+    volatile uint32_t _head;
+    uint32_t _read_idx, _tail_cache;
+    uint8_t _pad2[MBED_UTIL_CACHE_LINE_SIZE];
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_SPSC_RING_BUFFER_H__
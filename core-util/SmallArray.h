@@ -0,0 +1,97 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_SMALL_ARRAY_H__
+#define __MBED_UTIL_SMALL_ARRAY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/Array.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+namespace detail {
+
+// Inline storage for the first zone of a SmallArray. It is a base class of SmallArray that comes
+// before Array, so it is constructed before (and destroyed after) the Array that uses it.
+template <typename T, size_t N>
+struct small_array_storage {
+    alignas(T) alignas(void*) uint8_t _inline_zone[Array<T>::get_zone_storage_size(N)];
+};
+
+} // namespace detail
+
+/** An Array that keeps its first N elements inside the object.
+  *
+  * The first zone of a SmallArray (N elements) is stored in the SmallArray itself, so an array that
+  * never holds more than N elements doesn't allocate any memory. When more elements are added, the
+  * array grows like an Array, with zones allocated with mbed_ualloc. 'shrink_to_fit' moves the
+  * elements back inside the object if they fit.
+  *
+  * The elements of a SmallArray are never padded (their alignment is the alignment of T).
+  *
+  * SmallArray can be used wherever an Array is expected. Its init() hides Array's init(), and an
+  * initialized SmallArray refuses a second initialization (also through Array's init()).
+  *
+  * Usage example:
+  *
+  * @code
+  * SmallArray<uint16_t, 8> ids;
+  * ids.init(8, traits); // no memory is allocated
+  * ids.push_back(1);
+  * @endcode
+  */
+template <typename T, size_t N>
+class SmallArray: private detail::small_array_storage<T, N>, public Array<T> {
+    static_assert(N > 0, "SmallArray needs space for at least one element");
+
+public:
+    /** Create a new array
+      */
+    SmallArray() {}
+
+    /** Initialize the array. This never allocates memory.
+      * @param grow_capacity number of elements to add when the array runs out of memory
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @param mode storage mode of the array (see Array::init)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t grow_capacity, UAllocTraits_t alloc_traits, array_mode_t mode = array_segmented) {
+        return this->init_with_storage(N, grow_capacity, alloc_traits, alignof(T), mode, this->_inline_zone);
+    }
+
+    /** Check if the array uses only the memory inside the object
+      * @returns true if the array has no zones allocated with mbed_ualloc, false otherwise
+      */
+    bool is_inline() const {
+        return this->uses_only_storage();
+    }
+
+    /** Returns the number of elements that can be stored inside the object
+      * @returns number of inline elements (N)
+      */
+    static size_t get_inline_capacity() {
+        return N;
+    }
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_SMALL_ARRAY_H__
@@ -0,0 +1,356 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_SOA_ARRAY_H__
+#define __MBED_UTIL_SOA_ARRAY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <new>
+#include "core-util/Array.h"
+#include "core-util/assert.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+namespace detail {
+
+// The columns of a SoAArray: an Array for the first field, followed by the columns of the other fields
+template <typename... Fields>
+struct soa_columns {
+    bool init(size_t, size_t, UAllocTraits_t) { return true; }
+    void reset() {}
+    bool push_back() { return true; }
+    void pop_back() {}
+    bool reserve(size_t) { return true; }
+    void clear() {}
+    bool shrink_to_fit() { return true; }
+    unsigned get_capacity(unsigned limit) const { return limit; }
+};
+
+template <typename Field, typename... Rest>
+struct soa_columns<Field, Rest...> {
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits) {
+        // Each column is aligned to its field type, so its elements are not padded
+        if (!column.init(initial_capacity, grow_capacity, alloc_traits, alignof(Field)))
+            return false;
+        if (!rest.init(initial_capacity, grow_capacity, alloc_traits)) {
+            // Release this column, so the whole array can be initialized again
+            reset_column();
+            return false;
+        }
+        return true;
+    }
+
+    // Destroy all the columns and construct them again, uninitialized
+    void reset() {
+        reset_column();
+        rest.reset();
+    }
+
+    void reset_column() {
+        column.~Array<Field>();
+        new(&column) Array<Field>();
+    }
+
+    bool push_back(const Field& value, const Rest&... values) {
+        if (!column.push_back(value))
+            return false;
+        if (!rest.push_back(values...)) {
+            column.pop_back();
+            return false;
+        }
+        return true;
+    }
+
+    void pop_back() {
+        column.pop_back();
+        rest.pop_back();
+    }
+
+    bool reserve(size_t n) {
+        return column.reserve(n) && rest.reserve(n);
+    }
+
+    void clear() {
+        column.clear();
+        rest.clear();
+    }
+
+    bool shrink_to_fit() {
+        // Try all the columns, even if one of them fails
+        bool res = column.shrink_to_fit();
+        return rest.shrink_to_fit() && res;
+    }
+
+    // The smallest capacity of all the columns (not larger than 'limit')
+    unsigned get_capacity(unsigned limit) const {
+        unsigned capacity = column.get_capacity();
+        return rest.get_capacity(capacity < limit ? capacity : limit);
+    }
+
+    Array<Field> column;
+    soa_columns<Rest...> rest;
+};
+
+// Access to the column of field 'I'
+template <size_t I>
+struct soa_column_getter {
+    template <typename Columns>
+    static auto get(Columns& columns) -> decltype(soa_column_getter<I - 1>::get(columns.rest)) {
+        return soa_column_getter<I - 1>::get(columns.rest);
+    }
+};
+
+template <>
+struct soa_column_getter<0> {
+    template <typename Columns>
+    static auto get(Columns& columns) -> decltype((columns.column)) {
+        return columns.column;
+    }
+};
+
+} // namespace detail
+
+/** A structure-of-arrays companion to Array. Each element (row) of a SoAArray has one value for
+  * each of the given field types, but the values of each field are stored in their own column
+  * (an Array of that field type). Scanning a single field only reads the memory of that field,
+  * so scans can use all the cache lines they pull in and can be vectorized.
+  *
+  * The columns grow together, with the same semantics as Array ('initial_capacity' elements at
+  * first, then zones of 'grow_capacity' elements). Field 'I' of element 'idx' is accessed with
+  * 'get<I>(idx)', and all the values of field 'I' can be scanned zone by zone with
+  * 'for_each_span<I>()'.
+  *
+  * Unlike Array, SoAArray is NOT reentrant: elements must be added or removed by a single context
+  * at a time.
+  *
+  * Usage example:
+  *
+  * @code
+  * SoAArray<uint32_t, float> samples; // (timestamp, value)
+  * samples.init(64, 64, traits);
+  * samples.push_back(now, 1.5f);
+  * float sum = 0;
+  * samples.for_each_span<1>([&sum](const float *values, size_t count) {
+  *     for (size_t i = 0; i < count; i ++)
+  *         sum += values[i];
+  * });
+  * @endcode
+  */
+template <typename... Fields>
+class SoAArray {
+public:
+    /** The type of field 'I'
+      */
+    template <size_t I>
+    using field_type = typename std::tuple_element<I, std::tuple<Fields...> >::type;
+
+    /** Create a new array
+      */
+    SoAArray() {}
+
+    /* Forbid copy and assignment */
+    SoAArray(const SoAArray&) = delete;
+    SoAArray(SoAArray&&) = delete;
+    SoAArray& operator =(const SoAArray&) = delete;
+    SoAArray& operator =(SoAArray&&) = delete;
+
+    /** Initialize the array
+      * @param initial_capacity initial number of elements in the array
+      * @param grow_capacity number of elements to add when the array runs out of memory
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits) {
+        if (_initialized)
+            return false; // prevent repeated initialization
+        // If a column can't be initialized, the columns before it are released, so init() can be
+        // called again later
+        _initialized = _columns.init(initial_capacity, grow_capacity, alloc_traits);
+        return _initialized;
+    }
+
+    /** Adds an element at the end of the array
+      * @param values the value of each field of the new element
+      * @returns true if the element was added, false otherwise (out of memory/uninitialised)
+      */
+    bool push_back(const Fields&... values) {
+        if (!_initialized || !_columns.push_back(values...))
+            return false;
+        _elements ++;
+        return true;
+    }
+
+    /** Removes the last element in the array
+      * @returns true if an element was removed, false if the array is empty
+      */
+    bool pop_back() {
+        if (_elements == 0)
+            return false;
+        _elements --;
+        _columns.pop_back();
+        return true;
+    }
+
+    /** Make sure that all the columns have space for at least 'n' elements
+      * If a column can't grow, the columns before it keep their new capacity, and get_capacity()
+      * still reports the capacity of the smallest column.
+      * @param n number of elements
+      * @returns true if the array has space for 'n' elements, false otherwise (see Array::reserve)
+      */
+    bool reserve(size_t n) {
+        return _initialized && _columns.reserve(n);
+    }
+
+    /** Removes all the elements in the array (the memory of the array isn't released)
+      */
+    void clear() {
+        _elements = 0;
+        _columns.clear();
+    }
+
+    /** Compacts the memory of all the columns (see Array::shrink_to_fit)
+      * A column that can't be compacted keeps its capacity; the other columns are still compacted.
+      * @returns true if all the columns were compacted, false otherwise
+      */
+    bool shrink_to_fit() {
+        return _initialized && _columns.shrink_to_fit();
+    }
+
+    /** Return a reference to field 'I' of an existing element
+      * Calling this function with an invalid index results in undefined behaviour!
+      * @param idx element index
+      * @returns reference to field 'I' of the element at 'idx'
+      */
+    template <size_t I>
+    field_type<I>& get(unsigned idx) {
+        return column<I>()[idx];
+    }
+
+    /** Return a reference to field 'I' of an existing element (const version)
+      * Calling this function with an invalid index results in undefined behaviour!
+      * @param idx element index
+      * @returns const reference to field 'I' of the element at 'idx'
+      */
+    template <size_t I>
+    const field_type<I>& get(unsigned idx) const {
+        return column<I>()[idx];
+    }
+
+    /** Return a reference to field 'I' of an existing element
+      * Calling this function with an invalid index results in a runtime error.
+      * @param idx element index
+      * @returns reference to field 'I' of the element at 'idx'
+      */
+    template <size_t I>
+    field_type<I>& at(unsigned idx) {
+        check_access(idx);
+        return column<I>()[idx];
+    }
+
+    /** Return a reference to field 'I' of an existing element (const version)
+      * Calling this function with an invalid index results in a runtime error.
+      * @param idx element index
+      * @returns const reference to field 'I' of the element at 'idx'
+      */
+    template <size_t I>
+    const field_type<I>& at(unsigned idx) const {
+        check_access(idx);
+        return column<I>()[idx];
+    }
+
+    /** Return the column of field 'I'
+      * The column must not be modified directly (elements must be added and removed through the
+      * SoAArray), but it can be used for iterating over the values of the field.
+      * @returns the Array that holds the values of field 'I'
+      */
+    template <size_t I>
+    Array<field_type<I> >& column() {
+        return detail::soa_column_getter<I>::get(_columns);
+    }
+
+    /** Return the column of field 'I' (const version)
+      * @returns the Array that holds the values of field 'I'
+      */
+    template <size_t I>
+    const Array<field_type<I> >& column() const {
+        return detail::soa_column_getter<I>::get(_columns);
+    }
+
+    /** Call a function for each contiguous span of values of field 'I', in order
+      * The function is called as 'f(field_type<I> *values, size_t count)' (see Array::for_each_span)
+      * @param f function (or function object) to call for each span
+      */
+    template <size_t I, typename F>
+    void for_each_span(F&& f) {
+        column<I>().for_each_span(f);
+    }
+
+    /** Call a function for each contiguous span of values of field 'I', in order (const version)
+      * The function is called as 'f(const field_type<I> *values, size_t count)'
+      * @param f function (or function object) to call for each span
+      */
+    template <size_t I, typename F>
+    void for_each_span(F&& f) const {
+        column<I>().for_each_span(f);
+    }
+
+    /** Returns the number of elements in the array
+      * @returns number of elements
+      */
+    unsigned get_num_elements() const {
+        return _elements;
+    }
+
+    /** Returns the capacity of the array: the number of elements that can be added to all the
+      * columns without allocating memory (the columns might have different capacities after a
+      * failed reserve() or shrink_to_fit())
+      * @returns capacity of the array
+      */
+    unsigned get_capacity() const {
+        return _columns.get_capacity(column<0>().get_capacity());
+    }
+
+    /** Returns the number of fields of each element
+      * @returns number of fields
+      */
+    static size_t get_num_fields() {
+        return sizeof...(Fields);
+    }
+
+private:
+    void check_access(unsigned idx) const {
+        if (!_initialized) {
+            CORE_UTIL_RUNTIME_ERROR("Attempt to use uninitialized SoAArray %p\r\n", this);
+        }
+        if (idx >= _elements) {
+            CORE_UTIL_RUNTIME_ERROR("Attempt to use invalid index %u in SoAArray %p\r\n", idx, this);
+        }
+    }
+
+    detail::soa_columns<Fields...> _columns;
+    volatile unsigned _elements = 0;
+    bool _initialized = false;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_SOA_ARRAY_H__
@@ -134,6 +134,40 @@ T atomic_decr(T *valuePtr, T delta)
     }
 }
 
+/**
+ * Atomic load with acquire semantics: the memory accesses that follow it (in
+ * program order) can't be moved before it. Paired with atomic_store_release(),
+ * this publishes data from one context to another: whatever was written
+ * before the release store is visible after the acquire load that reads the
+ * stored value.
+ *
+ * The generic implementation reads the value in a critical section, which is
+ * enough on single-core targets. It is specialized with memory barriers for
+ * ARMv7-M and above, and with the compiler's atomic builtins on POSIX targets.
+ *
+ * @param  valuePtr Memory location being read.
+ * @return          The value read.
+ */
+template<typename T>
+T atomic_load_acquire(T *valuePtr)
+{
+    CriticalSectionLock lock;
+    return *(volatile T*)valuePtr;
+}
+
+/**
+ * Atomic store with release semantics: the memory accesses that precede it
+ * (in program order) can't be moved after it. See atomic_load_acquire().
+ * @param  valuePtr Memory location being written.
+ * @param  value    The value to write.
+ */
+template<typename T>
+void atomic_store_release(T *valuePtr, T value)
+{
+    CriticalSectionLock lock;
+    *(volatile T*)valuePtr = value;
+}
+
 /* For ARMv7-M and above, we use the load/store-exclusive instructions to
  * implement atomic_cas, so we provide three template specializations
  * corresponding to the byte, half-word, and word variants of the instructions.
@@ -159,8 +193,72 @@ template<>
 uint16_t atomic_decr(uint16_t * valuePtr, uint16_t delta);
 template<>
 uint32_t atomic_decr(uint32_t * valuePtr, uint32_t delta);
+
+template<>
+uint8_t atomic_load_acquire(uint8_t *valuePtr);
+template<>
+uint16_t atomic_load_acquire(uint16_t *valuePtr);
+template<>
+uint32_t atomic_load_acquire(uint32_t *valuePtr);
+
+template<>
+void atomic_store_release(uint8_t *valuePtr, uint8_t value);
+template<>
+void atomic_store_release(uint16_t *valuePtr, uint16_t value);
+template<>
+void atomic_store_release(uint32_t *valuePtr, uint32_t value);
 #endif /* #if (__CORTEX_M >= 0x03) */
 
+/* On POSIX targets the generic implementation is not atomic between threads (the critical section
+ * only masks signals), so we provide specializations based on the compiler's atomic builtins.
+ */
+#if defined(TARGET_LIKE_POSIX)
+template<>
+bool atomic_cas(uint8_t *ptr, uint8_t *expectedCurrentValue, uint8_t desiredValue);
+template<>
+bool atomic_cas(uint16_t *ptr, uint16_t *expectedCurrentValue, uint16_t desiredValue);
+template<>
+bool atomic_cas(uint32_t *ptr, uint32_t *expectedCurrentValue, uint32_t desiredValue);
+template<>
+bool atomic_cas(uint64_t *ptr, uint64_t *expectedCurrentValue, uint64_t desiredValue);
+
+template<>
+uint8_t atomic_incr(uint8_t * valuePtr, uint8_t delta);
+template<>
+uint16_t atomic_incr(uint16_t * valuePtr, uint16_t delta);
+template<>
+uint32_t atomic_incr(uint32_t * valuePtr, uint32_t delta);
+template<>
+uint64_t atomic_incr(uint64_t * valuePtr, uint64_t delta);
+
+template<>
+uint8_t atomic_decr(uint8_t * valuePtr, uint8_t delta);
+template<>
+uint16_t atomic_decr(uint16_t * valuePtr, uint16_t delta);
+template<>
+uint32_t atomic_decr(uint32_t * valuePtr, uint32_t delta);
+template<>
+uint64_t atomic_decr(uint64_t * valuePtr, uint64_t delta);
+
+template<>
+uint8_t atomic_load_acquire(uint8_t *valuePtr);
+template<>
+uint16_t atomic_load_acquire(uint16_t *valuePtr);
+template<>
+uint32_t atomic_load_acquire(uint32_t *valuePtr);
+template<>
+uint64_t atomic_load_acquire(uint64_t *valuePtr);
+
+template<>
+void atomic_store_release(uint8_t *valuePtr, uint8_t value);
+template<>
+void atomic_store_release(uint16_t *valuePtr, uint16_t value);
+template<>
+void atomic_store_release(uint32_t *valuePtr, uint32_t value);
+template<>
+void atomic_store_release(uint64_t *valuePtr, uint64_t value);
+#endif /* #if defined(TARGET_LIKE_POSIX) */
+
 } // namespace util
 } // namespace mbed
 
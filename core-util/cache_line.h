@@ -0,0 +1,33 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_CACHE_LINE_H__
+#define __MBED_UTIL_CACHE_LINE_H__
+
+/* Size of a cache line. Data written by different contexts is kept this far apart (SPSCRingBuffer
+ * indices, MultiQueue sub-queues) to avoid false sharing */
+#ifndef YOTTA_CFG_CORE_UTIL_CACHE_LINE_SIZE
+#if defined(TARGET_LIKE_POSIX)
+#define YOTTA_CFG_CORE_UTIL_CACHE_LINE_SIZE 64
+#else
+#define YOTTA_CFG_CORE_UTIL_CACHE_LINE_SIZE 32
+#endif
+#endif
+
+#define MBED_UTIL_CACHE_LINE_SIZE YOTTA_CFG_CORE_UTIL_CACHE_LINE_SIZE
+
+#endif // #ifndef __MBED_UTIL_CACHE_LINE_H__
@@ -0,0 +1,46 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_ZERO_MEMORY_H__
+#define __MBED_UTIL_ZERO_MEMORY_H__
+
+#include <stddef.h>
+
+/* Blocks at least this large are cleared with non-temporal stores (where available), so that
+ * clearing them doesn't evict the whole cache */
+#ifndef YOTTA_CFG_CORE_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD
+#define YOTTA_CFG_CORE_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD (256 * 1024)
+#endif
+
+#define MBED_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD YOTTA_CFG_CORE_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD
+
+namespace mbed {
+namespace util {
+
+/** Set a memory area to 0
+  * The strategy is chosen from the size and alignment of the area: small areas are cleared
+  * with memset(), larger ones with the widest stores available on the target (SSE2 on x86-64,
+  * NEON on ARM cores that have it) and very large ones with non-temporal stores (x86-64 only).
+  * @param ptr start of the memory area (no alignment requirements)
+  * @param size size of the memory area in bytes
+  */
+void zero_memory(void *ptr, size_t size);
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_ZERO_MEMORY_H__
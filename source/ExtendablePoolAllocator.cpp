@@ -18,6 +18,8 @@
 #include "core-util/ExtendablePoolAllocator.h"
 #include "core-util/PoolAllocator.h"
 #include "core-util/CriticalSectionLock.h"
+#include "core-util/zero_memory.h"
+#include "core-util/atomic_ops.h"
 #include "ualloc/ualloc.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -27,7 +29,12 @@
 namespace mbed {
 namespace util {
 
-ExtendablePoolAllocator::ExtendablePoolAllocator(): _head(NULL) {
+ExtendablePoolAllocator::ExtendablePoolAllocator(): _head(NULL), _scan_cursor(NULL), _pools_created(0), _empty_pools(0),
+    _uncached(0), _trim_high_watermark(0), _trim_low_watermark(0), _max_pool_elements(0), _growth_policy(growth_fixed) {
+    for (unsigned i = 0; i < max_lookup_levels; i ++)
+        _lookup[i] = NULL;
+    for (unsigned i = 0; i < nonfull_slots; i ++)
+        _nonfull[i] = NULL;
 }
 
 bool ExtendablePoolAllocator::init(size_t initial_elements, size_t new_pool_elements, size_t element_size, UAllocTraits_t alloc_traits, unsigned alignment) {
@@ -37,8 +44,12 @@ bool ExtendablePoolAllocator::init(size_t initial_elements, size_t new_pool_elem
     _element_size = PoolAllocator::align_up(element_size, alignment);
     _alloc_traits = alloc_traits;
     _alignment = alignment;
-    _head = create_new_pool(initial_elements, NULL);
-    return _head != NULL;
+    pool_link *head = create_new_pool(initial_elements, NULL);
+    if (head == NULL)
+        return false;
+    lookup_insert(head);
+    _head = head;
+    return true;
 }
 
 ExtendablePoolAllocator::~ExtendablePoolAllocator() {
@@ -57,54 +68,85 @@ void* ExtendablePoolAllocator::alloc() {
     // Try the current pool first
     if (NULL == _head)
         return NULL;
-    void *blk = _head->allocator.alloc();
+    pool_link *prev_head = _head;
+    void *blk = pool_alloc(prev_head, NULL);
     if (blk != NULL)
         return blk;
 
-    // Try all the other pools
-    pool_link *prev_head = _head;
-    pool_link *crt = prev_head->prev;
-    while (crt != NULL) {
-        if ((blk = crt->allocator.alloc()) != NULL) {
+    // Try the pools that are known to have free space
+    if ((blk = nonfull_alloc()) != NULL)
+        return blk;
+    if (_uncached > 0) {
+        nonfull_refill();
+        if ((blk = nonfull_alloc()) != NULL)
             return blk;
-        }
-        crt = crt->prev;
     }
 
-    // Not enough space, need to create another pool
-    {
-        CriticalSectionLock lock; // execute with interrupts disabled
-        if (_head != prev_head) { // if someone else already allocated a new pool, use it
-            if ((blk = _head->allocator.alloc()) != NULL) {
+    // Not enough space, need to create another pool. Several contexts can get here at the same
+    // time: each of them creates a pool and tries to publish it as the new head with a CAS.
+    pool_link *head = _head, *new_pool = NULL;
+    while (true) {
+        if (head != prev_head) { // if someone else already published a new pool, use it
+            if ((blk = pool_alloc(head, NULL)) != NULL) {
+                if (new_pool != NULL) // we lost the race, so our pool isn't needed anymore
+                    discard_pool(new_pool);
                 return blk;
             }
+            prev_head = head;
         }
-        // Create a new pool and link it in the list of pools
-        if ((crt = create_new_pool(_new_pool_elements, _head)) != NULL) {
-            _head = crt;
-            return crt->allocator.alloc();
+        if (new_pool == NULL) {
+            size_t elements = get_new_pool_elements(head);
+            if ((elements == 0) || ((new_pool = create_new_pool(elements, head)) == NULL))
+                return NULL;
         }
+        new_pool->prev = head;
+        if (atomic_cas((uintptr_t*)&_head, (uintptr_t*)&head, (uintptr_t)new_pool)) {
+            lookup_insert(new_pool);
+            if ((blk = pool_alloc(new_pool, NULL)) != NULL)
+                return blk;
+            // Other contexts already took all the elements of the new pool, grow again
+            prev_head = head = new_pool;
+            new_pool = NULL;
+        }
+        // Otherwise 'head' was updated by the failed CAS, try to use it
     }
-    return NULL;
+}
+
+void ExtendablePoolAllocator::set_fixed_growth() {
+    _growth_policy = growth_fixed;
+}
+
+void ExtendablePoolAllocator::set_geometric_growth(size_t max_pool_elements) {
+    _max_pool_elements = max_pool_elements;
+    _growth_policy = growth_geometric;
+}
+
+void ExtendablePoolAllocator::set_growth_callback(GrowthCallback::static_fp function) {
+    _growth_callback.attach(function);
+    _growth_policy = growth_callback;
 }
 
 void *ExtendablePoolAllocator::calloc() {
-    uint32_t *blk = (uint32_t*)alloc();
+    void *blk = alloc();
 
     if (blk == NULL)
         return NULL;
-    for (unsigned i = 0; i < _element_size / 4; i ++, blk ++)
-        *blk = 0;
+    zero_memory(blk, _element_size);
     return blk;
 }
 
 void ExtendablePoolAllocator::free(void *p) {
-    pool_link *crt = _head;
+    pool_link *crt = lookup_owner(p);
 
-    // Delegate freeing to the pool that owns the pointer
+    if (crt != NULL) {
+        pool_free(crt, p);
+        return;
+    }
+    // A pool that was just created might not be in the lookup list yet, so check all the pools
+    crt = _head;
     while (crt != NULL) {
         if (crt->allocator.owns(p)) {
-            crt->allocator.free(p);
+            pool_free(crt, p);
             return;
         }
         crt = crt->prev;
@@ -122,18 +164,262 @@ unsigned ExtendablePoolAllocator::get_num_pools() const {
     return cnt;
 }
 
-ExtendablePoolAllocator::pool_link* ExtendablePoolAllocator::create_new_pool(size_t elements, pool_link *prev) const {
+unsigned ExtendablePoolAllocator::get_num_empty_pools() const {
+    return _empty_pools;
+}
+
+unsigned ExtendablePoolAllocator::trim(unsigned keep_empty) {
+    CriticalSectionLock lock;
+    pool_link *crt = _head, *newer = NULL, *prev;
+    unsigned released = 0, empty = 0;
+
+    // Walk from the most recent pool to the oldest one, keeping the first 'keep_empty' empty pools
+    while (crt != NULL) {
+        prev = crt->prev;
+        if ((crt->live == 0) && (empty ++ >= keep_empty) && ((crt != _head) || (prev != NULL))) {
+            release_pool(crt, newer);
+            released ++;
+        } else {
+            newer = crt;
+        }
+        crt = prev;
+    }
+    return released;
+}
+
+void ExtendablePoolAllocator::set_trim_watermarks(unsigned high_watermark, unsigned low_watermark) {
+    _trim_high_watermark = high_watermark;
+    _trim_low_watermark = low_watermark < high_watermark ? low_watermark : 0;
+}
+
+bool ExtendablePoolAllocator::needs_trim() const {
+    return (_trim_high_watermark > 0) && (_empty_pools > _trim_high_watermark);
+}
+
+unsigned ExtendablePoolAllocator::trim_if_needed() {
+    return needs_trim() ? trim(_trim_low_watermark) : 0;
+}
+
+void *ExtendablePoolAllocator::pool_alloc(pool_link *link, pool_link *volatile *slot) {
+    // The element is counted before it is allocated, so 'live' never drops below the number of
+    // allocated elements. A pool that was found full can then only get free space back through
+    // pool_release(), which sees 'live' going below 'elements' and adds the pool to '_nonfull'.
+    if (atomic_incr(&link->live, (uint32_t)1) == 1)
+        atomic_decr(&_empty_pools, (uint32_t)1);
+    void *blk = link->allocator.alloc();
+    if (blk == NULL) {
+        // The pool is full: forget it (if it came from '_nonfull') before giving back the count,
+        // so the pool_release() that makes it non-full again can add it back to '_nonfull'
+        uintptr_t expected = (uintptr_t)link;
+        if ((slot != NULL) && atomic_cas((uintptr_t*)slot, &expected, (uintptr_t)NULL))
+            link->cached = 0;
+        pool_release(link);
+    }
+    return blk;
+}
+
+void ExtendablePoolAllocator::pool_free(pool_link *link, void *p) {
+    link->allocator.free(p);
+    pool_release(link);
+}
+
+void ExtendablePoolAllocator::pool_release(pool_link *link) {
+    uint32_t live = atomic_decr(&link->live, (uint32_t)1);
+    // Empty pools are only counted here: releasing them is left to trim(), since another
+    // context might be allocating from this pool right now
+    if (live == 0)
+        atomic_incr(&_empty_pools, (uint32_t)1);
+    if ((live == link->elements - 1) && !nonfull_insert(link))
+        atomic_incr(&_uncached, (uint32_t)1);
+}
+
+bool ExtendablePoolAllocator::nonfull_insert(pool_link *link) {
+    // The context that sets the 'cached' flag adds the pool; if the flag is already set, the pool
+    // is already in '_nonfull'
+    uint8_t not_cached = 0;
+    if (!atomic_cas(&link->cached, &not_cached, (uint8_t)1))
+        return true;
+    for (unsigned i = 0; i < nonfull_slots; i ++) {
+        uintptr_t expected = (uintptr_t)NULL;
+        if ((_nonfull[i] == NULL) && atomic_cas((uintptr_t*)&_nonfull[i], &expected, (uintptr_t)link))
+            return true;
+    }
+    link->cached = 0;
+    return false;
+}
+
+void *ExtendablePoolAllocator::nonfull_alloc() {
+    for (unsigned i = 0; i < nonfull_slots; i ++) {
+        pool_link *link = _nonfull[i];
+        void *blk;
+        if ((link != NULL) && ((blk = pool_alloc(link, &_nonfull[i])) != NULL))
+            return blk;
+    }
+    return NULL;
+}
+
+void ExtendablePoolAllocator::nonfull_refill() {
+    // Only one context refills the table: the one that resets '_uncached'. Pools that get free
+    // space during the refill count themselves in '_uncached' again if they don't fit.
+    uint32_t uncached = _uncached;
+    while (uncached > 0) {
+        if (atomic_cas(&_uncached, &uncached, (uint32_t)0))
+            break;
+    }
+    if (uncached == 0)
+        return;
+    // Walk the pools once, starting where the previous refill stopped and wrapping around to
+    // the most recent pool, until the table is full
+    pool_link *start = _scan_cursor != NULL ? _scan_cursor : _head, *crt = start;
+    do {
+        if ((crt->live < crt->elements) && !nonfull_insert(crt)) {
+            _scan_cursor = crt;
+            atomic_incr(&_uncached, (uint32_t)1);
+            return;
+        }
+        crt = crt->prev != NULL ? crt->prev : _head;
+    } while (crt != start);
+}
+
+bool ExtendablePoolAllocator::is_consistent() const {
+    for (unsigned i = 0; i < nonfull_slots; i ++) {
+        pool_link *link = _nonfull[i];
+        if (link == NULL)
+            continue;
+        if (link->cached == 0)
+            return false;
+        for (unsigned j = i + 1; j < nonfull_slots; j ++) {
+            if (_nonfull[j] == link)
+                return false;
+        }
+        const pool_link *crt = _head;
+        while ((crt != NULL) && (crt != link))
+            crt = crt->prev;
+        if (crt == NULL)
+            return false;
+    }
+    // Every flagged pool must be in the table
+    for (const pool_link *crt = _head; crt != NULL; crt = crt->prev) {
+        if (crt->cached == 0)
+            continue;
+        unsigned i;
+        for (i = 0; (i < nonfull_slots) && (_nonfull[i] != crt); i ++);
+        if (i == nonfull_slots)
+            return false;
+    }
+    return true;
+}
+
+void ExtendablePoolAllocator::release_pool(pool_link *link, pool_link *newer) {
+    // Unlink the pool from the list of pools and from the lookup list, then free its memory
+    if (newer == NULL)
+        _head = link->prev;
+    else
+        newer->prev = link->prev;
+    for (unsigned i = 0; i < nonfull_slots; i ++) {
+        if (_nonfull[i] == link)
+            _nonfull[i] = NULL;
+    }
+    if (_scan_cursor == link)
+        _scan_cursor = NULL;
+    lookup_remove(link);
+    discard_pool(link);
+}
+
+void ExtendablePoolAllocator::discard_pool(pool_link *link) {
+    // The pool must be empty and not linked anywhere
+    atomic_decr(&_empty_pools, (uint32_t)1);
+    void *area = link->allocator.get_start_address();
+    link->~pool_link(); // this assumes that the PoolAllocator doesn't free its storage!
+    mbed_ufree(area);
+}
+
+size_t ExtendablePoolAllocator::get_new_pool_elements(const pool_link *head) {
+    switch (_growth_policy) {
+        case growth_geometric:
+            // The first pool after the initial one uses the base size, then the size doubles
+            if (head->prev == NULL)
+                return _new_pool_elements;
+            return 2 * head->elements < _max_pool_elements ? 2 * head->elements : _max_pool_elements;
+        case growth_callback:
+            return _growth_callback ? _growth_callback.call(get_num_pools(), head->elements) : 0;
+        default:
+            return _new_pool_elements;
+    }
+}
+
+ExtendablePoolAllocator::pool_link* ExtendablePoolAllocator::create_new_pool(size_t elements, pool_link *prev) {
+    // Pick the height of the new pool in the lookup skip list: each level is used with half the
+    // probability of the level below. The "random" bits come from a hash of the pool number.
+    uint32_t h = atomic_incr(&_pools_created, (uint32_t)1);
+    h = ((h >> 16) ^ h) * 0x45d9f3b;
+    h = ((h >> 16) ^ h) * 0x45d9f3b;
+    h = (h >> 16) ^ h;
+    unsigned levels = 1;
+    while ((levels < max_lookup_levels) && (h & 1)) {
+        levels ++;
+        h >>= 1;
+    }
+
     // Create a pool instance + the actual pool space + a link to the previous pool allocator in the chain in a contigous memory area.
-    // Layout: pool storage area | pool_link structure (pointer to previous pool and PoolAllocator instance)
+    // Layout: pool storage area | pool_link structure (pointer to previous pool, PoolAllocator instance and skip list links)
     // Since the pool storage area aligns all the allocations internally to at least 4 bytes, the pool_link address will be correctly aligned
     size_t pool_storage_size = PoolAllocator::get_pool_size(elements, _element_size, _alignment);
-    void *temp = mbed_ualloc(pool_storage_size + sizeof(pool_link), _alloc_traits);
+    void *temp = mbed_ualloc(pool_storage_size + sizeof(pool_link) + (levels - 1) * sizeof(pool_link*), _alloc_traits);
     if (temp == NULL)
         return NULL;
-    pool_link *p = new((char*)temp + pool_storage_size) pool_link(temp, elements, _element_size, _alignment, prev);
+    pool_link *p = new((char*)temp + pool_storage_size) pool_link(temp, elements, _element_size, _alignment, prev, levels);
+    atomic_incr(&_empty_pools, (uint32_t)1);
     return p;
 }
 
+void ExtendablePoolAllocator::lookup_insert(pool_link *link) {
+    const uintptr_t key = (uintptr_t)link->allocator.get_start_address();
+
+    // Link the new pool from the bottom level up. Since pools are never removed from the list
+    // while other operations are running, a CAS on the predecessor's link is enough.
+    for (unsigned level = 0; level < link->levels; level ++) {
+        while (true) {
+            pool_link **links = _lookup;
+            for (unsigned l = max_lookup_levels; l -- > level; ) {
+                pool_link *n;
+                while (((n = links[l]) != NULL) && ((uintptr_t)n->allocator.get_start_address() < key))
+                    links = n->next;
+            }
+            uintptr_t succ = (uintptr_t)links[level];
+            link->next[level] = (pool_link*)succ;
+            if (atomic_cas((uintptr_t*)&links[level], &succ, (uintptr_t)link))
+                break;
+        }
+    }
+}
+
+void ExtendablePoolAllocator::lookup_remove(pool_link *link) {
+    const void *key = link->allocator.get_start_address();
+    pool_link **links = _lookup;
+
+    for (unsigned l = max_lookup_levels; l -- > 0; ) {
+        pool_link *n;
+        while (((n = links[l]) != NULL) && (n->allocator.get_start_address() < key))
+            links = n->next;
+        if ((l < link->levels) && (links[l] == link))
+            links[l] = link->next[l];
+    }
+}
+
+ExtendablePoolAllocator::pool_link* ExtendablePoolAllocator::lookup_owner(const void *p) const {
+    // Find the pool with the highest start address that is not above 'p'
+    pool_link *const *links = _lookup, *candidate = NULL, *n;
+
+    for (unsigned l = max_lookup_levels; l -- > 0; ) {
+        while (((n = links[l]) != NULL) && (n->allocator.get_start_address() <= p)) {
+            candidate = n;
+            links = n->next;
+        }
+    }
+    return (candidate != NULL) && candidate->allocator.owns(p) ? candidate : NULL;
+}
+
 } // namespace util
 } // namespace mbed
 
@@ -21,41 +21,111 @@
 #include <stdio.h>
 
 #include "core-util/atomic_ops.h"
+#include "core-util/zero_memory.h"
 
 namespace mbed {
 namespace util {
 
-PoolAllocator::PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment):
+PoolAllocator::PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment, bool lazy_init):
     _start(start), _element_size(align_up(element_size, alignment)) {
     _end = (void*)((uint8_t*)start + _element_size * elements);
-    _init();
+    // Free blocks are identified by their offset in the pool (in 'alignment' units, plus one, so
+    // that 0 can mark the end of the list). The bits that are not needed for the offset hold the
+    // generation counter.
+    _offset_shift = 0;
+    while ((1U << _offset_shift) < alignment)
+        _offset_shift ++;
+    _max_offset = (uint32_t)((_element_size * elements) >> _offset_shift);
+    _offset_bits = 1;
+    while ((_offset_bits < 31) && (((uint32_t)1 << _offset_bits) <= _max_offset))
+        _offset_bits ++;
+    _init(lazy_init);
 }
 
 void* PoolAllocator::alloc() {
-    uintptr_t prev_free = reinterpret_cast<uintptr_t>(_free_block);
+    free_list_head_t prev_head = _free_head;
     while (true) {
-        if (0 == prev_free)
-            return NULL;
-        void **const new_free = (void **)(*((void **)prev_free));
-        if (atomic_cas((uintptr_t*)&_free_block, &prev_free, (uintptr_t)new_free)) {
-            return (void*)prev_free;
+        const uint32_t offset = _get_head_offset(prev_head);
+        if (0 == offset)
+            return _alloc_untouched();
+        void *blk = _get_block(offset);
+        // If 'blk' is allocated (and possibly freed again) by someone else after we read the head,
+        // the link below might be stale, but the generation counter will be different, so the CAS fails
+        const free_list_head_t new_head = _make_head(*((uint32_t*)blk), prev_head);
+        if (atomic_cas(&_free_head, &prev_head, new_head)) {
+            return blk;
+        }
+    }
+}
+
+size_t PoolAllocator::alloc_n(void **out, size_t n) {
+    free_list_head_t prev_head = _free_head;
+    while (true) {
+        // Walk the free list to find the first 'n' blocks, then detach them all at once
+        uint32_t offset = _get_head_offset(prev_head);
+        size_t cnt = 0;
+        bool stale = false;
+        while ((cnt < n) && (offset != 0)) {
+            // A concurrent update of the list can make us read garbage links. Don't follow them
+            // outside the pool, just start again with the new head
+            if (!_is_valid_offset(offset)) {
+                stale = true;
+                break;
+            }
+            out[cnt] = _get_block(offset);
+            offset = *((uint32_t*)out[cnt ++]);
+        }
+        if (stale) {
+            prev_head = _free_head;
+            continue;
+        }
+        if (cnt == 0)
+            return _alloc_n_untouched(out, n);
+        if (atomic_cas(&_free_head, &prev_head, _make_head(offset, prev_head))) {
+            if (cnt < n)
+                cnt += _alloc_n_untouched(out + cnt, n - cnt);
+            return cnt;
         }
     }
 }
 
 void PoolAllocator::free(void* p) {
     if (owns(p)) {
+        const uint32_t offset = _get_offset(p);
+        free_list_head_t prev_head = _free_head;
         while (true) {
-            uintptr_t prev_free = reinterpret_cast<uintptr_t>(_free_block);
-
-            *((void**)p) = (void*)prev_free;
-            if (atomic_cas((uintptr_t*)&_free_block, &prev_free, (uintptr_t)p)) {
+            *((uint32_t*)p) = _get_head_offset(prev_head);
+            if (atomic_cas(&_free_head, &prev_head, _make_head(offset, prev_head))) {
                 break;
             }
         }
     }
 }
 
+void PoolAllocator::free_n(void **in, size_t n) {
+    // Link all the blocks owned by this pool in a chain, then put the chain in front of the list
+    void *first = NULL, *last = NULL;
+    for (size_t i = 0; i < n; i ++) {
+        if (!owns(in[i]))
+            continue;
+        if (last == NULL)
+            first = in[i];
+        else
+            *((uint32_t*)last) = _get_offset(in[i]);
+        last = in[i];
+    }
+    if (first == NULL)
+        return;
+    const uint32_t first_offset = _get_offset(first);
+    free_list_head_t prev_head = _free_head;
+    while (true) {
+        *((uint32_t*)last) = _get_head_offset(prev_head);
+        if (atomic_cas(&_free_head, &prev_head, _make_head(first_offset, prev_head))) {
+            break;
+        }
+    }
+}
+
 bool PoolAllocator::owns(const void *p) const {
     return (p >= _start) && (p < _end);
 }
@@ -66,12 +136,11 @@ size_t PoolAllocator::get_pool_size(size_t elements, size_t element_size, unsign
 }
 
 void* PoolAllocator::calloc() {
-    uint32_t *blk = (uint32_t*)alloc();
+    void *blk = alloc();
 
     if (NULL == blk)
         return NULL;
-    for(unsigned i = 0; i < _element_size / 4; i ++, blk ++)
-        *blk = 0;
+    zero_memory(blk, _element_size);
     return blk;
 }
 
@@ -83,23 +152,72 @@ void* PoolAllocator::get_start_address() const {
     return _start;
 }
 
-void PoolAllocator::_init() {
-    _free_block = _start;
+void PoolAllocator::_init(bool lazy_init) {
+    _free_head = 0;
+    if (lazy_init) {
+        _untouched = _get_offset(_start);
+        return;
+    }
+    _untouched = _max_offset + 1;
 
     // Link all free blocks using offsets.
-    void* next;
-    void* blk = _free_block;
+    uint8_t *blk = (uint8_t*)_start;
+    uint8_t *const end = (uint8_t*)_end;
+
+    if (blk == end)
+        return;
+    while (blk + _element_size < end) {
+        *((uint32_t*)blk) = _get_offset(blk + _element_size);
+        blk += _element_size;
+    }
+    // mark the last block as the end of the list
+    *((uint32_t*)blk) = 0;
+    _free_head = _make_head(_get_offset(_start), 0);
+}
+
+void *PoolAllocator::_alloc_untouched() {
+    void *blk;
+    return _alloc_n_untouched(&blk, 1) ? blk : NULL;
+}
 
-    while(true) {
-        next = ((uint8_t *) blk) + _element_size;
-        if(next > _end)
+size_t PoolAllocator::_alloc_n_untouched(void **out, size_t n) {
+    const uint32_t units = (uint32_t)(_element_size >> _offset_shift);
+    uint32_t prev_untouched = _untouched, cnt;
+    // Move the high water mark past the elements that we take
+    while (true) {
+        if (prev_untouched > _max_offset)
+            return 0;
+        const uint32_t available = (_max_offset + 1 - prev_untouched) / units;
+        cnt = n < available ? (uint32_t)n : available;
+        if (atomic_cas(&_untouched, &prev_untouched, prev_untouched + cnt * units)) {
             break;
-        *((void **)blk) = next;
-        blk = next;
+        }
     }
-    // count back one block and mark it as the last one
-    blk = ((uint8_t *) blk) - _element_size;
-    *((void **)blk) = 0;
+    for (uint32_t i = 0; i < cnt; i ++)
+        out[i] = _get_block(prev_untouched + i * units);
+    return cnt;
+}
+
+void *PoolAllocator::_get_block(uint32_t offset) const {
+    return (uint8_t*)_start + ((size_t)(offset - 1) << _offset_shift);
+}
+
+bool PoolAllocator::_is_valid_offset(uint32_t offset) const {
+    return (offset > 0) && (offset <= _max_offset);
+}
+
+uint32_t PoolAllocator::_get_offset(const void *p) const {
+    return (uint32_t)(((const uint8_t*)p - (const uint8_t*)_start) >> _offset_shift) + 1;
+}
+
+uint32_t PoolAllocator::_get_head_offset(free_list_head_t head) const {
+    return (uint32_t)(head & (((free_list_head_t)1 << _offset_bits) - 1));
+}
+
+PoolAllocator::free_list_head_t PoolAllocator::_make_head(uint32_t offset, free_list_head_t prev_head) const {
+    // Keep the generation counter of the previous head and increment it
+    const free_list_head_t generation = (prev_head >> _offset_bits) + 1;
+    return (generation << _offset_bits) | offset;
 }
 
 } // namespace util
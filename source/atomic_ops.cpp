@@ -124,7 +124,179 @@ uint32_t atomic_decr(uint32_t * valuePtr, uint32_t delta)
     } while (__STREXW(newValue, valuePtr));
     return newValue;}
 
+/* The data memory barrier orders the accesses of this core as seen by the other bus masters */
+
+template<>
+uint8_t atomic_load_acquire(uint8_t *valuePtr)
+{
+    uint8_t value = *(volatile uint8_t*)valuePtr;
+    __DMB();
+    return value;
+}
+
+template<>
+uint16_t atomic_load_acquire(uint16_t *valuePtr)
+{
+    uint16_t value = *(volatile uint16_t*)valuePtr;
+    __DMB();
+    return value;
+}
+
+template<>
+uint32_t atomic_load_acquire(uint32_t *valuePtr)
+{
+    uint32_t value = *(volatile uint32_t*)valuePtr;
+    __DMB();
+    return value;
+}
+
+template<>
+void atomic_store_release(uint8_t *valuePtr, uint8_t value)
+{
+    __DMB();
+    *(volatile uint8_t*)valuePtr = value;
+}
+
+template<>
+void atomic_store_release(uint16_t *valuePtr, uint16_t value)
+{
+    __DMB();
+    *(volatile uint16_t*)valuePtr = value;
+}
+
+template<>
+void atomic_store_release(uint32_t *valuePtr, uint32_t value)
+{
+    __DMB();
+    *(volatile uint32_t*)valuePtr = value;
+}
+
 #endif /* #if (__CORTEX_M >= 0x03) */
 
+/* On POSIX targets, use the compiler's atomic builtins (sequentially consistent for the read-modify-write operations) */
+#if defined(TARGET_LIKE_POSIX)
+
+template<>
+bool atomic_cas(uint8_t *ptr, uint8_t *expectedCurrentValue, uint8_t desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+template<>
+bool atomic_cas(uint16_t *ptr, uint16_t *expectedCurrentValue, uint16_t desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+template<>
+bool atomic_cas(uint32_t *ptr, uint32_t *expectedCurrentValue, uint32_t desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+template<>
+bool atomic_cas(uint64_t *ptr, uint64_t *expectedCurrentValue, uint64_t desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint8_t atomic_incr(uint8_t * valuePtr, uint8_t delta)
+{
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint16_t atomic_incr(uint16_t * valuePtr, uint16_t delta)
+{
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint32_t atomic_incr(uint32_t * valuePtr, uint32_t delta)
+{
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint64_t atomic_incr(uint64_t * valuePtr, uint64_t delta)
+{
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint8_t atomic_decr(uint8_t * valuePtr, uint8_t delta)
+{
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint16_t atomic_decr(uint16_t * valuePtr, uint16_t delta)
+{
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint32_t atomic_decr(uint32_t * valuePtr, uint32_t delta)
+{
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint64_t atomic_decr(uint64_t * valuePtr, uint64_t delta)
+{
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+template<>
+uint8_t atomic_load_acquire(uint8_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_ACQUIRE);
+}
+
+template<>
+uint16_t atomic_load_acquire(uint16_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_ACQUIRE);
+}
+
+template<>
+uint32_t atomic_load_acquire(uint32_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_ACQUIRE);
+}
+
+template<>
+uint64_t atomic_load_acquire(uint64_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_ACQUIRE);
+}
+
+template<>
+void atomic_store_release(uint8_t *valuePtr, uint8_t value)
+{
+    __atomic_store_n(valuePtr, value, __ATOMIC_RELEASE);
+}
+
+template<>
+void atomic_store_release(uint16_t *valuePtr, uint16_t value)
+{
+    __atomic_store_n(valuePtr, value, __ATOMIC_RELEASE);
+}
+
+template<>
+void atomic_store_release(uint32_t *valuePtr, uint32_t value)
+{
+    __atomic_store_n(valuePtr, value, __ATOMIC_RELEASE);
+}
+
+template<>
+void atomic_store_release(uint64_t *valuePtr, uint64_t value)
+{
+    __atomic_store_n(valuePtr, value, __ATOMIC_RELEASE);
+}
+
+#endif /* #if defined(TARGET_LIKE_POSIX) */
+
 } // namespace util
 } // namespace mbed
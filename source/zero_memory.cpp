@@ -0,0 +1,100 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/zero_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ZERO_MEMORY_VECTOR_SIZE 16
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZERO_MEMORY_VECTOR_SIZE 16
+#endif
+
+namespace mbed {
+namespace util {
+
+#if defined(ZERO_MEMORY_VECTOR_SIZE)
+
+// Areas smaller than this are not worth the alignment prologue/epilogue
+static const size_t vector_threshold = 4 * ZERO_MEMORY_VECTOR_SIZE;
+
+// Clear 'size' bytes starting at 'p', which is aligned to ZERO_MEMORY_VECTOR_SIZE.
+// 'size' is a multiple of 4 * ZERO_MEMORY_VECTOR_SIZE.
+static void zero_aligned_vectors(uint8_t *p, size_t size) {
+    uint8_t *const end = p + size;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    if (size >= MBED_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD) {
+        for (; p < end; p += 4 * ZERO_MEMORY_VECTOR_SIZE) {
+            _mm_stream_si128((__m128i*)p, zero);
+            _mm_stream_si128((__m128i*)(p + 16), zero);
+            _mm_stream_si128((__m128i*)(p + 32), zero);
+            _mm_stream_si128((__m128i*)(p + 48), zero);
+        }
+        // Non-temporal stores are weakly ordered, make them visible before returning
+        _mm_sfence();
+        return;
+    }
+    for (; p < end; p += 4 * ZERO_MEMORY_VECTOR_SIZE) {
+        _mm_store_si128((__m128i*)p, zero);
+        _mm_store_si128((__m128i*)(p + 16), zero);
+        _mm_store_si128((__m128i*)(p + 32), zero);
+        _mm_store_si128((__m128i*)(p + 48), zero);
+    }
+#else // NEON
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for (; p < end; p += 4 * ZERO_MEMORY_VECTOR_SIZE) {
+        vst1q_u8(p, zero);
+        vst1q_u8(p + 16, zero);
+        vst1q_u8(p + 32, zero);
+        vst1q_u8(p + 48, zero);
+    }
+#endif
+}
+
+void zero_memory(void *ptr, size_t size) {
+    uint8_t *p = (uint8_t*)ptr;
+
+    if (size < vector_threshold) {
+        memset(p, 0, size);
+        return;
+    }
+    // Clear the unaligned head and tail with memset, the (aligned) middle part with vector stores
+    const size_t head = (ZERO_MEMORY_VECTOR_SIZE - ((uintptr_t)p & (ZERO_MEMORY_VECTOR_SIZE - 1))) & (ZERO_MEMORY_VECTOR_SIZE - 1);
+    memset(p, 0, head);
+    p += head;
+    size -= head;
+    const size_t body = size & ~(4 * ZERO_MEMORY_VECTOR_SIZE - 1);
+    zero_aligned_vectors(p, body);
+    memset(p + body, 0, size - body);
+}
+
+#else // #if defined(ZERO_MEMORY_VECTOR_SIZE)
+
+void zero_memory(void *ptr, size_t size) {
+    // No vector unit: the C library's memset already uses the widest stores available
+    memset(ptr, 0, size);
+}
+
+#endif // #if defined(ZERO_MEMORY_VECTOR_SIZE)
+
+} // namespace util
+} // namespace mbed
@@ -22,6 +22,11 @@
 #include "utest/utest.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#include <pthread.h>
+#endif
 
 using namespace utest::v1;
 using namespace mbed::util;
@@ -150,6 +155,622 @@ static void test_non_pod() {
     TEST_ASSERT_EQUAL(0, Test::inst_count);
 }
 
+static void test_many_zones() {
+    {
+    Array<Test> array;
+
+    const size_t initial_capacity = 5, grow_capacity = 3, total = 1000;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(array.init(initial_capacity, grow_capacity, traits));
+
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, i & 0xFF)));
+    }
+    TEST_ASSERT_EQUAL(total, array.get_num_elements());
+    TEST_ASSERT_EQUAL(1 + (total - initial_capacity + grow_capacity - 1) / grow_capacity, array.get_num_zones());
+    TEST_ASSERT_EQUAL(total, Test::inst_count);
+    // Access the elements in order and in a scattered order
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(array.at(i) == Test(i, i & 0xFF));
+    }
+    for (unsigned i = 0, idx = 0; i < total; i ++, idx = (idx + 397) % total) {
+        TEST_ASSERT_TRUE(array[idx] == Test(idx, idx & 0xFF));
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+static void test_contiguous() {
+    {
+    Array<Test> array;
+
+    const size_t initial_capacity = 4, grow_capacity = 3, total = 100;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(array.init(initial_capacity, grow_capacity, traits, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, array_contiguous));
+    TEST_ASSERT_TRUE(array.is_contiguous());
+
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, 'c')));
+        // All the elements must be contiguous after each relocation
+        TEST_ASSERT_EQUAL(1, array.get_num_zones());
+        TEST_ASSERT_EQUAL(i + 1, array.end() - array.begin());
+    }
+    TEST_ASSERT_TRUE(array.get_capacity() >= total);
+    TEST_ASSERT_EQUAL(total, Test::inst_count);
+    const Test *p = array.data();
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(p[i] == Test(i, 'c'));
+        TEST_ASSERT_TRUE(&array[i] == p + i);
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+
+    // Trivially copyable types are relocated with memcpy
+    Array<uint8_t> bytes;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(bytes.init(1, 1, traits, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, array_contiguous));
+    const char text[] = "contiguous array";
+    for (unsigned i = 0; i < sizeof(text); i ++) {
+        TEST_ASSERT_TRUE(bytes.push_back(text[i]));
+    }
+    TEST_ASSERT_EQUAL(0, memcmp(bytes.data(), text, sizeof(text)));
+    unsigned sum = 0;
+    for (Array<uint8_t>::const_iterator b = bytes.begin(); b != bytes.end(); b ++) {
+        sum += *b;
+    }
+    unsigned expected = 0;
+    for (unsigned i = 0; i < sizeof(text); i ++) {
+        expected += (uint8_t)text[i];
+    }
+    TEST_ASSERT_EQUAL(expected, sum);
+
+    // An array that is not contiguous doesn't expose its data
+    Array<unsigned> segmented;
+    TEST_ASSERT_TRUE(segmented.init(1, 1, traits));
+    TEST_ASSERT_FALSE(segmented.is_contiguous());
+    TEST_ASSERT_TRUE(segmented.data() == NULL);
+}
+
+static void sum_span(const unsigned *p, size_t count, unsigned &sum) {
+    for (size_t i = 0; i < count; i ++) {
+        sum += p[i];
+    }
+}
+
+struct SpanSummer {
+    SpanSummer(): sum(0), spans(0) {}
+
+    void operator ()(const unsigned *p, size_t count) {
+        sum_span(p, count, sum);
+        spans ++;
+    }
+
+    unsigned sum, spans;
+};
+
+static void test_iterators() {
+    Array<unsigned> array;
+
+    const size_t initial_capacity = 7, grow_capacity = 5, total = 100;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(array.init(initial_capacity, grow_capacity, traits, sizeof(unsigned)));
+    TEST_ASSERT_TRUE(array.begin() == array.end());
+    for (unsigned i = 0; i < total; i ++) {
+        array.push_back(i);
+    }
+
+    // Forward traversal across all the zones
+    unsigned idx = 0;
+    for (Array<unsigned>::iterator it = array.begin(); it != array.end(); ++ it, ++ idx) {
+        TEST_ASSERT_EQUAL(idx, *it);
+        TEST_ASSERT_TRUE(&*it == &array[idx]);
+        *it = 2 * idx;
+    }
+    TEST_ASSERT_EQUAL(total, idx);
+    TEST_ASSERT_EQUAL(total, array.end() - array.begin());
+
+    // Backward traversal
+    Array<unsigned>::iterator it = array.end();
+    while (it != array.begin()) {
+        -- it;
+        -- idx;
+        TEST_ASSERT_EQUAL(2 * idx, *it);
+    }
+    TEST_ASSERT_EQUAL(0, idx);
+
+    // Random access
+    const Array<unsigned>& carray = array;
+    Array<unsigned>::const_iterator cit = carray.begin();
+    for (unsigned i = 0; i < total; i += 13) {
+        TEST_ASSERT_EQUAL(2 * i, cit[i]);
+        TEST_ASSERT_EQUAL(2 * i, *(cit + i));
+        TEST_ASSERT_EQUAL(2 * (total - 1 - i), *(carray.end() - (i + 1)));
+    }
+    cit += 42;
+    TEST_ASSERT_EQUAL(84, *cit);
+    cit -= 40;
+    TEST_ASSERT_EQUAL(4, *cit);
+    TEST_ASSERT_TRUE(cit > carray.begin());
+    TEST_ASSERT_TRUE(Array<unsigned>::const_iterator(array.begin()) == carray.begin());
+
+    // Zone-wise traversal: one span per zone
+    SpanSummer summer;
+    carray.for_each_span(summer);
+    TEST_ASSERT_EQUAL(total * (total - 1), summer.sum);
+    TEST_ASSERT_EQUAL(array.get_num_zones(), summer.spans);
+
+    // Padded elements are given one by one
+    Array<uint16_t> padded;
+    TEST_ASSERT_TRUE(padded.init(4, 4, traits, 8));
+    for (unsigned i = 0; i < 10; i ++) {
+        padded.push_back(i);
+    }
+    unsigned spans = 0, sum = 0;
+    padded.for_each_span([&](uint16_t *p, size_t count) {
+        TEST_ASSERT_EQUAL(1, count);
+        sum += *p;
+        spans ++;
+    });
+    TEST_ASSERT_EQUAL(10, spans);
+    TEST_ASSERT_EQUAL(45, sum);
+}
+
+struct MoveOnly {
+    MoveOnly(unsigned v = 0): value(new unsigned(v)) {}
+    MoveOnly(MoveOnly&& m): value(m.value) {
+        m.value = NULL;
+    }
+    MoveOnly(const MoveOnly&) = delete;
+    MoveOnly& operator =(const MoveOnly&) = delete;
+    ~MoveOnly() {
+        delete value;
+    }
+
+    unsigned *value;
+};
+
+static void test_emplace_and_append() {
+    UAllocTraits_t traits = {0};
+    {
+    Array<Test> array;
+    TEST_ASSERT_TRUE(array.init(4, 4, traits));
+
+    // emplace_back constructs the element in place
+    TEST_ASSERT_TRUE(array.emplace_back(10, 'e'));
+    TEST_ASSERT_TRUE(array.emplace_back());
+    TEST_ASSERT_EQUAL(2, Test::inst_count);
+    TEST_ASSERT_TRUE(array[0] == Test(10, 'e'));
+    TEST_ASSERT_TRUE(array[1] == Test(0, 0));
+
+    // append copies all the elements and grows the array with a single zone
+    Test *src = (Test*)malloc(30 * sizeof(Test));
+    TEST_ASSERT_TRUE(src != NULL);
+    for (unsigned i = 0; i < 30; i ++) {
+        new(src + i) Test(i, 'a');
+    }
+    TEST_ASSERT_TRUE(array.append(src, 30));
+    TEST_ASSERT_EQUAL(32, array.get_num_elements());
+    TEST_ASSERT_EQUAL(2, array.get_num_zones());
+    TEST_ASSERT_EQUAL(4 + 28, array.get_capacity());
+    for (unsigned i = 0; i < 30; i ++) {
+        TEST_ASSERT_TRUE(array[i + 2] == Test(i, 'a'));
+    }
+    TEST_ASSERT_EQUAL(62, Test::inst_count);
+    // The array keeps growing normally after that
+    TEST_ASSERT_TRUE(array.push_back(Test(100, 'b')));
+    TEST_ASSERT_EQUAL(3, array.get_num_zones());
+    TEST_ASSERT_TRUE(array.at(32) == Test(100, 'b'));
+    for (unsigned i = 0; i < 30; i ++) {
+        src[i].~Test();
+    }
+    free(src);
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+
+    // Trivially copyable elements, with and without padding
+    for (unsigned alignment = 2; alignment <= 8; alignment *= 4) {
+        Array<uint16_t> words;
+        TEST_ASSERT_TRUE(words.init(3, 5, traits, alignment));
+        uint16_t values[100];
+        for (unsigned i = 0; i < 100; i ++) {
+            values[i] = i * 3;
+        }
+        TEST_ASSERT_TRUE(words.append(values, 1));
+        TEST_ASSERT_TRUE(words.append(values + 1, 99));
+        TEST_ASSERT_TRUE(words.append(values, 0));
+        TEST_ASSERT_EQUAL(100, words.get_num_elements());
+        for (unsigned i = 0; i < 100; i ++) {
+            TEST_ASSERT_EQUAL(i * 3, words[i]);
+        }
+        // Iterator ranges are copied the same way, across zones
+        TEST_ASSERT_TRUE(words.append(words.begin() + 10, words.begin() + 60));
+        TEST_ASSERT_EQUAL(150, words.get_num_elements());
+        for (unsigned i = 0; i < 50; i ++) {
+            TEST_ASSERT_EQUAL((i + 10) * 3, words[100 + i]);
+        }
+    }
+
+    // Arrays that can't grow don't change if the new elements don't fit
+    Array<unsigned> fixed;
+    TEST_ASSERT_TRUE(fixed.init(4, 0, traits));
+    unsigned values[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_FALSE(fixed.append(values, 5));
+    TEST_ASSERT_EQUAL(0, fixed.get_num_elements());
+    TEST_ASSERT_TRUE(fixed.append(values, 4));
+    TEST_ASSERT_FALSE(fixed.push_back(5));
+
+    // Move-only types, in all modes
+    const array_mode_t modes[] = {array_segmented, array_contiguous, array_concurrent};
+    for (unsigned k = 0; k < sizeof(modes) / sizeof(modes[0]); k ++) {
+        Array<MoveOnly> moved;
+        TEST_ASSERT_TRUE(moved.init(2, 2, traits, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, modes[k]));
+        for (unsigned i = 0; i < 10; i ++) {
+            MoveOnly m(i);
+            TEST_ASSERT_TRUE(moved.push_back(std::move(m)));
+            TEST_ASSERT_TRUE(m.value == NULL);
+        }
+        TEST_ASSERT_TRUE(moved.emplace_back(10));
+        for (unsigned i = 0; i < 11; i ++) {
+            TEST_ASSERT_EQUAL(i, *moved[i].value);
+        }
+    }
+}
+
+static void test_reserve_and_shrink() {
+    UAllocTraits_t traits = {0};
+    {
+    Array<Test> array;
+    TEST_ASSERT_FALSE(array.reserve(10)); // not initialized
+    TEST_ASSERT_TRUE(array.init(4, 5, traits));
+
+    // Reserving space that is already available doesn't change the array
+    TEST_ASSERT_TRUE(array.reserve(3));
+    TEST_ASSERT_EQUAL(4, array.get_capacity());
+    TEST_ASSERT_EQUAL(1, array.get_num_zones());
+
+    // Reserving more space adds a single zone (multiple of grow_capacity)
+    TEST_ASSERT_TRUE(array.reserve(50));
+    TEST_ASSERT_EQUAL(2, array.get_num_zones());
+    TEST_ASSERT_EQUAL(4 + 50, array.get_capacity());
+    for (unsigned i = 0; i < 54; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, 'r')));
+    }
+    TEST_ASSERT_EQUAL(2, array.get_num_zones());
+    TEST_ASSERT_TRUE(array.push_back(Test(54, 'r')));
+    TEST_ASSERT_EQUAL(3, array.get_num_zones());
+    for (unsigned i = 0; i < 55; i ++) {
+        TEST_ASSERT_TRUE(array[i] == Test(i, 'r'));
+    }
+
+    // Shrink after removing some elements: a single zone with the remaining elements
+    for (unsigned i = 0; i < 25; i ++) {
+        array.pop_back();
+    }
+    TEST_ASSERT_TRUE(array.shrink_to_fit());
+    TEST_ASSERT_EQUAL(1, array.get_num_zones());
+    TEST_ASSERT_EQUAL(30, array.get_capacity());
+    TEST_ASSERT_EQUAL(30, array.get_num_elements());
+    TEST_ASSERT_EQUAL(30, Test::inst_count);
+    for (unsigned i = 0; i < 30; i ++) {
+        TEST_ASSERT_TRUE(array[i] == Test(i, 'r'));
+    }
+
+    // The array grows as usual after shrinking
+    for (unsigned i = 30; i < 42; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, 'r')));
+    }
+    TEST_ASSERT_EQUAL(4, array.get_num_zones());
+    for (unsigned i = 0; i < 42; i ++) {
+        TEST_ASSERT_TRUE(array.at(i) == Test(i, 'r'));
+    }
+
+    // Clear and release all the memory
+    array.clear();
+    TEST_ASSERT_EQUAL(0, array.get_num_elements());
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+    TEST_ASSERT_TRUE(array.shrink_to_fit());
+    TEST_ASSERT_EQUAL(0, array.get_capacity());
+    TEST_ASSERT_EQUAL(1, array.get_num_zones());
+    TEST_ASSERT_TRUE(array.push_back(Test(1, 'x')));
+    TEST_ASSERT_TRUE(array[0] == Test(1, 'x'));
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+
+    // Contiguous arrays are reserved with the exact size
+    Array<unsigned> contiguous;
+    TEST_ASSERT_TRUE(contiguous.init(2, 2, traits, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, array_contiguous));
+    contiguous.push_back(7);
+    TEST_ASSERT_TRUE(contiguous.reserve(1000));
+    TEST_ASSERT_EQUAL(1000, contiguous.get_capacity());
+    TEST_ASSERT_EQUAL(7, contiguous.data()[0]);
+    TEST_ASSERT_TRUE(contiguous.shrink_to_fit());
+    TEST_ASSERT_EQUAL(1, contiguous.get_capacity());
+    TEST_ASSERT_EQUAL(7, contiguous.data()[0]);
+
+    // Arrays that can't grow can't reserve more space
+    Array<unsigned> fixed;
+    TEST_ASSERT_TRUE(fixed.init(4, 0, traits));
+    TEST_ASSERT_TRUE(fixed.reserve(4));
+    TEST_ASSERT_FALSE(fixed.reserve(5));
+}
+
+static void test_concurrent_mode() {
+    UAllocTraits_t traits = {0};
+    {
+    Array<Test> array;
+    TEST_ASSERT_TRUE(array.init(3, 4, traits, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, array_concurrent));
+    TEST_ASSERT_FALSE(array.pop_back());
+    for (unsigned i = 0; i < 20; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, 'p')));
+        TEST_ASSERT_EQUAL(i + 1, array.get_num_elements());
+    }
+    {
+        Test src[10];
+        TEST_ASSERT_TRUE(array.append(src, 10));
+    }
+    TEST_ASSERT_EQUAL(30, array.get_num_elements());
+    TEST_ASSERT_EQUAL(30, Test::inst_count);
+
+    // Removed elements can be added again
+    TEST_ASSERT_TRUE(array.pop_back());
+    TEST_ASSERT_TRUE(array.pop_back());
+    TEST_ASSERT_EQUAL(28, array.get_num_elements());
+    TEST_ASSERT_TRUE(array.emplace_back(100, 'e'));
+    TEST_ASSERT_EQUAL(29, array.get_num_elements());
+    TEST_ASSERT_TRUE(array[28] == Test(100, 'e'));
+    for (unsigned i = 0; i < 20; i ++) {
+        TEST_ASSERT_TRUE(array[i] == Test(i, 'p'));
+    }
+
+    array.clear();
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+    TEST_ASSERT_TRUE(array.reserve(100));
+    for (unsigned i = 0; i < 100; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Test(i, 'q')));
+    }
+    TEST_ASSERT_TRUE(array.shrink_to_fit());
+    TEST_ASSERT_TRUE(array.push_back(Test(100, 'q')));
+    TEST_ASSERT_EQUAL(101, array.get_num_elements());
+    for (unsigned i = 0; i < 101; i ++) {
+        TEST_ASSERT_TRUE(array.at(i) == Test(i, 'q'));
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+static const unsigned concurrent_threads = 4, concurrent_per_thread = 50000;
+
+struct ConcurrentAppendArgs {
+    Array<uint32_t> *array;
+    unsigned tid;
+    volatile bool *done;
+};
+
+static void *concurrent_append_thread(void *arg) {
+    ConcurrentAppendArgs *args = (ConcurrentAppendArgs*)arg;
+    uint32_t base = args->tid << 24;
+    for (uint32_t i = 0; i < concurrent_per_thread; ) {
+        // Add most elements one by one and some in small batches
+        if ((i % 7 == 0) && (i + 3 <= concurrent_per_thread)) {
+            uint32_t values[3] = {base | i, base | (i + 1), base | (i + 2)};
+            TEST_ASSERT_TRUE(args->array->append(values, 3));
+            i += 3;
+        } else {
+            TEST_ASSERT_TRUE(args->array->push_back(base | i));
+            i ++;
+        }
+    }
+    return NULL;
+}
+
+static void *concurrent_reader_thread(void *arg) {
+    ConcurrentAppendArgs *args = (ConcurrentAppendArgs*)arg;
+    unsigned checked = 0;
+    while (!*args->done) {
+        // All the visible elements must be constructed
+        unsigned n = args->array->get_num_elements();
+        for (; checked < n; checked ++) {
+            uint32_t v = (*args->array)[checked];
+            TEST_ASSERT_TRUE((v >> 24) < concurrent_threads);
+            TEST_ASSERT_TRUE((v & 0xFFFFFF) < concurrent_per_thread);
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_append() {
+    Array<uint32_t> array;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(array.init(16, 1000, traits, sizeof(uint32_t), array_concurrent));
+
+    volatile bool done = false;
+    pthread_t threads[concurrent_threads], reader;
+    ConcurrentAppendArgs args[concurrent_threads + 1];
+    for (unsigned t = 0; t <= concurrent_threads; t ++) {
+        args[t].array = &array;
+        args[t].tid = t;
+        args[t].done = &done;
+    }
+    TEST_ASSERT_EQUAL(0, pthread_create(&reader, NULL, concurrent_reader_thread, &args[concurrent_threads]));
+    for (unsigned t = 0; t < concurrent_threads; t ++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[t], NULL, concurrent_append_thread, &args[t]));
+    }
+    for (unsigned t = 0; t < concurrent_threads; t ++) {
+        pthread_join(threads[t], NULL);
+    }
+    done = true;
+    pthread_join(reader, NULL);
+
+    // Each thread's elements must all be there, in the order in which they were added
+    TEST_ASSERT_EQUAL(concurrent_threads * concurrent_per_thread, array.get_num_elements());
+    uint32_t next[concurrent_threads] = {0};
+    for (Array<uint32_t>::const_iterator it = array.begin(); it != array.end(); ++ it) {
+        uint32_t tid = *it >> 24;
+        TEST_ASSERT_TRUE(tid < concurrent_threads);
+        TEST_ASSERT_EQUAL(next[tid], *it & 0xFFFFFF);
+        next[tid] ++;
+    }
+    for (unsigned t = 0; t < concurrent_threads; t ++) {
+        TEST_ASSERT_EQUAL(concurrent_per_thread, next[t]);
+    }
+}
+
+static void benchmark_array_access() {
+    const size_t total = 1 << 16, accesses = 1 << 20;
+    const size_t grow_capacities[] = {total, 1024, 64, 16};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %18s\r\n", "zones", "operator[] (ns)");
+    for (size_t k = 0; k < sizeof(grow_capacities) / sizeof(grow_capacities[0]); k ++) {
+        Array<unsigned> array;
+        TEST_ASSERT_TRUE(array.init(1, grow_capacities[k], traits));
+        for (unsigned i = 0; i < total; i ++) {
+            array.push_back(i);
+        }
+
+        unsigned idx = 0, sum = 0;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t i = 0; i < accesses; i ++) {
+            sum += array[idx];
+            idx = (idx + 40503) & (total - 1);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        TEST_ASSERT_TRUE(sum != 1); // keep the loop from being optimized away
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        printf("%10u %18.2f\r\n", array.get_num_zones(), ns / accesses);
+    }
+}
+
+static void benchmark_array_scan() {
+    const size_t total = 1 << 18, rounds = 64;
+    UAllocTraits_t traits = {0};
+    Array<unsigned> segmented, contiguous;
+    TEST_ASSERT_TRUE(segmented.init(1024, 1024, traits, sizeof(unsigned)));
+    TEST_ASSERT_TRUE(contiguous.init(1024, 1024, traits, sizeof(unsigned), array_contiguous));
+    for (unsigned i = 0; i < total; i ++) {
+        segmented.push_back(i);
+        contiguous.push_back(i);
+    }
+
+    unsigned sum1 = 0, sum2 = 0, sum3 = 0, sum4 = 0;
+    struct timespec t0, t1, t2, t3, t4;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t r = 0; r < rounds; r ++) {
+        for (unsigned i = 0; i < total; i ++) {
+            sum1 += segmented[i];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (size_t r = 0; r < rounds; r ++) {
+        for (const unsigned *p = contiguous.data(), *e = p + contiguous.get_num_elements(); p != e; p ++) {
+            sum2 += *p;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    for (size_t r = 0; r < rounds; r ++) {
+        for (Array<unsigned>::const_iterator it = segmented.begin(), e = segmented.end(); it != e; ++ it) {
+            sum3 += *it;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    for (size_t r = 0; r < rounds; r ++) {
+        segmented.for_each_span([&sum4](const unsigned *p, size_t count) {
+            sum_span(p, count, sum4);
+        });
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t4);
+    TEST_ASSERT_EQUAL(sum1, sum2);
+    TEST_ASSERT_EQUAL(sum1, sum3);
+    TEST_ASSERT_EQUAL(sum1, sum4);
+    double ns1 = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    double ns2 = (t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec);
+    double ns3 = (t3.tv_sec - t2.tv_sec) * 1e9 + (t3.tv_nsec - t2.tv_nsec);
+    double ns4 = (t4.tv_sec - t3.tv_sec) * 1e9 + (t4.tv_nsec - t3.tv_nsec);
+    printf("%24s %18s\r\n", "scan", "element (ns)");
+    printf("%24s %18.3f\r\n", "segmented, operator[]", ns1 / (total * rounds));
+    printf("%24s %18.3f\r\n", "contiguous, pointer", ns2 / (total * rounds));
+    printf("%24s %18.3f\r\n", "segmented, iterator", ns3 / (total * rounds));
+    printf("%24s %18.3f\r\n", "segmented, for_each_span", ns4 / (total * rounds));
+}
+
+struct BenchmarkAppendArgs {
+    Array<uint32_t> *array;
+    unsigned count;
+};
+
+static void *benchmark_append_thread(void *arg) {
+    BenchmarkAppendArgs *args = (BenchmarkAppendArgs*)arg;
+    for (uint32_t i = 0; i < args->count; i ++) {
+        args->array->push_back(i);
+    }
+    return NULL;
+}
+
+static void benchmark_array_concurrent_append() {
+    const unsigned total = 1 << 16;
+    const unsigned thread_counts[] = {1, 2, 4};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %24s %24s\r\n", "threads", "segmented (ns/element)", "concurrent (ns/element)");
+    for (size_t k = 0; k < sizeof(thread_counts) / sizeof(thread_counts[0]); k ++) {
+        double ns[2];
+        for (unsigned concurrent = 0; concurrent < 2; concurrent ++) {
+            // Segmented arrays are only safe to use from a single thread on POSIX
+            const unsigned threads = concurrent ? thread_counts[k] : 1;
+            Array<uint32_t> array;
+            TEST_ASSERT_TRUE(array.init(1024, 1024, traits, sizeof(uint32_t), concurrent ? array_concurrent : array_segmented));
+            pthread_t tids[4];
+            BenchmarkAppendArgs args = {&array, total / threads};
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (unsigned t = 0; t < threads; t ++) {
+                TEST_ASSERT_EQUAL(0, pthread_create(&tids[t], NULL, benchmark_append_thread, &args));
+            }
+            for (unsigned t = 0; t < threads; t ++) {
+                pthread_join(tids[t], NULL);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            TEST_ASSERT_EQUAL(total, array.get_num_elements());
+            ns[concurrent] = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / total;
+        }
+        printf("%10u %24.2f %24.2f\r\n", thread_counts[k], ns[0], ns[1]);
+    }
+}
+
+static void benchmark_array_append() {
+    const size_t total = 1 << 16;
+    UAllocTraits_t traits = {0};
+    unsigned *values = (unsigned*)malloc(total * sizeof(unsigned));
+    TEST_ASSERT_TRUE(values != NULL);
+    for (unsigned i = 0; i < total; i ++) {
+        values[i] = i;
+    }
+
+    printf("%24s %18s\r\n", "load", "element (ns)");
+    for (unsigned bulk = 0; bulk < 2; bulk ++) {
+        Array<unsigned> array;
+        TEST_ASSERT_TRUE(array.init(1024, 1024, traits, sizeof(unsigned)));
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (bulk) {
+            TEST_ASSERT_TRUE(array.append(values, total));
+        } else {
+            for (unsigned i = 0; i < total; i ++) {
+                array.push_back(values[i]);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        TEST_ASSERT_EQUAL(total, array.get_num_elements());
+        TEST_ASSERT_EQUAL(total - 1, array[total - 1]);
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        printf("%24s %18.3f\r\n", bulk ? "append()" : "push_back()", ns / total);
+    }
+    free(values);
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
 static status_t test_setup(const size_t number_of_cases) {
     GREENTEA_SETUP(5, "default_auto");
 
@@ -163,7 +784,20 @@ status_t greentea_failure_handler(const Case *const source, const failure_t reas
 
 static Case cases[] = {
     Case("Array  - test with plain old data", test_pod, greentea_failure_handler),
-    Case("Array  - test with complex data", test_non_pod, greentea_failure_handler)
+    Case("Array  - test with complex data", test_non_pod, greentea_failure_handler),
+    Case("Array  - test with many zones", test_many_zones, greentea_failure_handler),
+    Case("Array  - test contiguous mode", test_contiguous, greentea_failure_handler),
+    Case("Array  - test iterators", test_iterators, greentea_failure_handler),
+    Case("Array  - test emplace_back and append", test_emplace_and_append, greentea_failure_handler),
+    Case("Array  - test reserve, clear and shrink_to_fit", test_reserve_and_shrink, greentea_failure_handler),
+    Case("Array  - test concurrent mode", test_concurrent_mode, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("Array  - test concurrent append", test_concurrent_append, greentea_failure_handler),
+    Case("Array  - benchmark element access", benchmark_array_access, greentea_failure_handler),
+    Case("Array  - benchmark full scan", benchmark_array_scan, greentea_failure_handler),
+    Case("Array  - benchmark loading elements", benchmark_array_append, greentea_failure_handler),
+    Case("Array  - benchmark concurrent append", benchmark_array_concurrent_append, greentea_failure_handler),
+#endif
 };
 
 static Specification specification(test_setup, cases, greentea_test_teardown_handler);
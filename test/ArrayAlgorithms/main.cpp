@@ -0,0 +1,244 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/ArrayAlgorithms.h"
+#include "core-util/atomic_ops.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+// Simple deterministic pseudo-random generator
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+static void fill_random(Array<uint32_t>& array, size_t n, uint32_t seed) {
+    for (size_t i = 0; i < n; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(next_random(seed) % 100000));
+    }
+}
+
+static void check_sorted(const Array<uint32_t>& array, uint64_t expected_sum) {
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < array.get_num_elements(); i ++) {
+        if (i > 0) {
+            TEST_ASSERT_TRUE(array[i - 1] <= array[i]);
+        }
+        sum += array[i];
+    }
+    TEST_ASSERT_TRUE(sum == expected_sum);
+}
+
+// Records are copied by several threads while sorting, so the instance count is atomic
+struct Record {
+    Record(unsigned k = 0, unsigned v = 0): key(k), value(v) {
+        atomic_incr(&inst_count, (uint32_t)1);
+    }
+
+    Record(const Record& r): key(r.key), value(r.value) {
+        atomic_incr(&inst_count, (uint32_t)1);
+    }
+
+    Record& operator =(const Record& r) {
+        key = r.key;
+        value = r.value;
+        return *this;
+    }
+
+    ~Record() {
+        atomic_decr(&inst_count, (uint32_t)1);
+    }
+
+    unsigned key, value;
+    static uint32_t inst_count;
+};
+
+uint32_t Record::inst_count = 0;
+
+static void test_sort() {
+    UAllocTraits_t traits = {0};
+    const size_t sizes[] = {0, 1, 2, 100, 5000, 3 * MBED_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS + 17};
+    const unsigned thread_counts[] = {1, 2, 3, 4, 0};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s ++) {
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t ++) {
+            Array<uint32_t> array;
+            TEST_ASSERT_TRUE(array.init(7, 1000, traits));
+            fill_random(array, sizes[s], s + t);
+            uint64_t sum = 0;
+            for (unsigned i = 0; i < array.get_num_elements(); i ++) {
+                sum += array[i];
+            }
+            sort(array, detail::array_less(), thread_counts[t]);
+            TEST_ASSERT_EQUAL(sizes[s], array.get_num_elements());
+            check_sorted(array, sum);
+        }
+    }
+
+    // Custom comparison and non trivial types, with padded elements
+    {
+    Array<Record> records;
+    TEST_ASSERT_TRUE(records.init(100, 333, traits, 16));
+    const unsigned total = 2 * MBED_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS + 1;
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < total; i ++) {
+        records.push_back(Record(next_random(seed) % 1000, i));
+    }
+    sort(records, [](const Record& a, const Record& b) { return a.key > b.key; }, 4);
+    TEST_ASSERT_EQUAL(total, Record::inst_count);
+    for (unsigned i = 1; i < total; i ++) {
+        TEST_ASSERT_TRUE(records[i - 1].key >= records[i].key);
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Record::inst_count);
+}
+
+static void test_lower_bound() {
+    UAllocTraits_t traits = {0};
+    Array<uint32_t> array;
+    TEST_ASSERT_TRUE(array.init(5, 3, traits));
+    TEST_ASSERT_EQUAL(0, lower_bound(array, 10));
+    // 0, 2, 2, 4, 4, 6, 6, ...
+    for (unsigned i = 0; i < 200; i ++) {
+        array.push_back((i + 1) / 2 * 2);
+    }
+    TEST_ASSERT_EQUAL(0, lower_bound(array, 0));
+    TEST_ASSERT_EQUAL(1, lower_bound(array, 1));
+    TEST_ASSERT_EQUAL(1, lower_bound(array, 2));
+    TEST_ASSERT_EQUAL(3, lower_bound(array, 3));
+    TEST_ASSERT_EQUAL(99, lower_bound(array, 100));
+    TEST_ASSERT_EQUAL(199, lower_bound(array, 199));
+    TEST_ASSERT_EQUAL(199, lower_bound(array, 200));
+    TEST_ASSERT_EQUAL(200, lower_bound(array, 201));
+
+    // Search by key with a custom comparison
+    Array<Record> records;
+    TEST_ASSERT_TRUE(records.init(5, 3, traits));
+    for (unsigned i = 0; i < 50; i ++) {
+        records.push_back(Record(i * 10, i));
+    }
+    unsigned idx = lower_bound(records, 125u, [](const Record& r, unsigned key) { return r.key < key; });
+    TEST_ASSERT_EQUAL(13, idx);
+    TEST_ASSERT_EQUAL(130, records[idx].key);
+}
+
+static void test_transform_and_reduce() {
+    UAllocTraits_t traits = {0};
+    const unsigned total = 3 * MBED_UTIL_ARRAY_PARALLEL_MIN_ELEMENTS + 5;
+    Array<uint32_t> array;
+    TEST_ASSERT_TRUE(array.init(100, 1000, traits));
+    for (unsigned i = 0; i < total; i ++) {
+        array.push_back(i);
+    }
+
+    const unsigned thread_counts[] = {1, 4, 0};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t ++) {
+        auto add = [](uint64_t a, uint64_t b) { return a + b; };
+        uint64_t sum = reduce(array, (uint64_t)0, add, add, thread_counts[t]);
+        TEST_ASSERT_TRUE(sum == (uint64_t)total * (total - 1) / 2);
+        auto max = [](uint32_t a, uint32_t b) { return a > b ? a : b; };
+        TEST_ASSERT_EQUAL(total - 1, reduce(array, (uint32_t)0, max, max, thread_counts[t]));
+        // The operation and the combination differ: the chunks are folded with 'op' and their
+        // results are only combined with 'combine'
+        uint64_t squares = reduce(array, (uint64_t)0, [](uint64_t acc, uint32_t v) { return acc + (uint64_t)v * v; },
+                                  add, thread_counts[t]);
+        TEST_ASSERT_TRUE(squares == reduce(array, (uint64_t)0, [](uint64_t acc, uint32_t v) { return acc + (uint64_t)v * v; }));
+    }
+    // The sequential version accepts any initial value
+    TEST_ASSERT_TRUE(reduce(array, (uint64_t)10, [](uint64_t acc, uint32_t v) { return acc + v; }) ==
+                     (uint64_t)total * (total - 1) / 2 + 10);
+
+    // By default, the function is called in the calling context, in order (so it can have state)
+    uint32_t next = 0;
+    transform(array, [&next](uint32_t v) { TEST_ASSERT_EQUAL(next, v); next ++; return v; });
+    TEST_ASSERT_EQUAL(total, next);
+
+    // In place
+    transform(array, [](uint32_t v) { return v * 3; }, 4);
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_EQUAL(i * 3, array[i]);
+    }
+
+    // To another array of a different type
+    Array<uint64_t> squares;
+    TEST_ASSERT_TRUE(squares.init(10, 10, traits));
+    squares.push_back(42);
+    TEST_ASSERT_TRUE(transform(array, squares, [](uint32_t v) { return (uint64_t)v * v; }));
+    TEST_ASSERT_EQUAL(total + 1, squares.get_num_elements());
+    TEST_ASSERT_TRUE(squares[0] == 42);
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(squares[i + 1] == (uint64_t)i * 3 * i * 3);
+    }
+}
+
+#if defined(TARGET_LIKE_POSIX)
+static void benchmark_sort() {
+    const size_t total = 1 << 21;
+    const unsigned thread_counts[] = {1, 2, 4};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %14s\r\n", "threads", "sort (ms)");
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t ++) {
+        Array<uint32_t> array;
+        TEST_ASSERT_TRUE(array.init(4096, 4096, traits, sizeof(uint32_t)));
+        fill_random(array, total, 12345);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        sort(array, detail::array_less(), thread_counts[t]);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        TEST_ASSERT_TRUE(array[0] <= array[total - 1]);
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        printf("%10u %14.1f\r\n", thread_counts[t], ms);
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("ArrayAlgorithms  - sort", test_sort, greentea_failure_handler),
+    Case("ArrayAlgorithms  - lower_bound", test_lower_bound, greentea_failure_handler),
+    Case("ArrayAlgorithms  - transform and reduce", test_transform_and_reduce, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("ArrayAlgorithms  - benchmark sort", benchmark_sort, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -22,6 +22,9 @@
 #include "utest/utest.h"
 #include <stdio.h>
 #include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
 
 using namespace utest::v1;
 using namespace mbed::util;
@@ -164,6 +167,190 @@ static void test_max_heap_non_pod() {
     printf("********** Ending test_max_heap_non_pod()\r\n");
 }
 
+static void test_remove_any() {
+    // Removing an element from the middle of the heap might need to move the last element up
+    // instead of down (here: 4 replaces 11, whose parent is 10)
+    {
+    BinaryHeap<int> heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(8, 8, traits));
+    const int data[] = {1, 10, 2, 11, 12, 3, 4};
+    for (unsigned i = 0; i < sizeof(data) / sizeof(data[0]); i ++) {
+        TEST_ASSERT_TRUE(heap.insert(data[i]));
+    }
+    TEST_ASSERT_TRUE(heap.remove(11));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    const int sorted[] = {1, 2, 3, 4, 10, 12};
+    for (unsigned i = 0; i < sizeof(sorted) / sizeof(sorted[0]); i ++) {
+        TEST_ASSERT_EQUAL(sorted[i], heap.pop_root());
+    }
+    }
+
+    // Random inserts and removes of non POD elements
+    {
+    BinaryHeap<Test, MaxCompare<Test> > heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(4, 16, traits));
+    uint32_t seed = 7;
+    for (unsigned i = 0; i < 300; i ++) {
+        seed = seed * 1103515245 + 12345;
+        TEST_ASSERT_TRUE(heap.insert(Test((seed >> 8) % 100, i % 3)));
+        if (i % 3 == 2) {
+            TEST_ASSERT_TRUE(heap.remove(Test((seed >> 8) % 100, i % 3)));
+        }
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_EQUAL(200, Test::inst_count);
+    int last = heap.get_root()._a;
+    while (!heap.is_empty()) {
+        Test t = heap.pop_root();
+        TEST_ASSERT_TRUE(t._a <= last);
+        last = t._a;
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+static void test_bulk_insert() {
+    UAllocTraits_t traits = {0};
+    uint32_t seed = 11;
+    int values[500];
+    for (unsigned i = 0; i < 500; i ++) {
+        seed = seed * 1103515245 + 12345;
+        values[i] = (seed >> 8) % 1000 - 500;
+    }
+
+    // insert_many on an empty heap (heapify), then on a larger heap (sift up)
+    {
+    BinaryHeap<int> heap;
+    TEST_ASSERT_TRUE(heap.init(10, 30, traits));
+    TEST_ASSERT_TRUE(heap.insert_many(values, 300));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(300, heap.get_num_elements());
+    TEST_ASSERT_TRUE(heap.insert_many(values + 300, 20));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_TRUE(heap.insert_many(values + 320, 180));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_TRUE(heap.insert_many(values, 0));
+    TEST_ASSERT_EQUAL(500, heap.get_num_elements());
+    int last = heap.pop_root();
+    while (!heap.is_empty()) {
+        int v = heap.pop_root();
+        TEST_ASSERT_TRUE(last <= v);
+        last = v;
+    }
+    }
+
+    // build_from an Array and from an iterator range replace the contents of the heap
+    {
+    Array<Test> src;
+    TEST_ASSERT_TRUE(src.init(64, 64, traits));
+    for (unsigned i = 0; i < 200; i ++) {
+        TEST_ASSERT_TRUE(src.push_back(Test(values[i], i % 7)));
+    }
+    BinaryHeap<Test, MaxCompare<Test> > heap;
+    TEST_ASSERT_TRUE(heap.init(16, 16, traits));
+    TEST_ASSERT_TRUE(heap.insert(Test(10000)));
+    TEST_ASSERT_TRUE(heap.build_from(src));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(200, heap.get_num_elements());
+    TEST_ASSERT_TRUE(heap.get_root()._a < 10000);
+    TEST_ASSERT_EQUAL(400, Test::inst_count);
+
+    TEST_ASSERT_TRUE(heap.build_from(src.begin() + 100, src.end()));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(100, heap.get_num_elements());
+    TEST_ASSERT_EQUAL(300, Test::inst_count);
+    int last = heap.pop_root()._a;
+    while (!heap.is_empty()) {
+        Test t = heap.pop_root();
+        TEST_ASSERT_TRUE(t._a <= last);
+        last = t._a;
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+struct LargeElement {
+    LargeElement(uint32_t k = 0): key(k) {
+        memset(payload, 0, sizeof(payload));
+    }
+
+    bool operator <=(const LargeElement& e) const {
+        return key <= e.key;
+    }
+
+    uint32_t key;
+    uint8_t payload[124];
+};
+
+template <typename T>
+static void benchmark_heap(const char *name, size_t n) {
+    BinaryHeap<T> heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(n, n, traits));
+    uint32_t seed = 1;
+    struct timespec t0, t1, t2;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < n; i ++) {
+        seed = seed * 1103515245 + 12345;
+        heap.insert(T(seed >> 8));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (size_t i = 0; i < n; i ++) {
+        heap.remove_root();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    TEST_ASSERT_TRUE(heap.is_empty());
+    double insert_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+    double pop_ns = ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) / n;
+    printf("%14s %10u %14.1f %14.1f\r\n", name, (unsigned)n, insert_ns, pop_ns);
+}
+
+static void benchmark_binary_heap() {
+    printf("%14s %10s %14s %14s\r\n", "element", "elements", "insert (ns)", "pop (ns)");
+    benchmark_heap<uint32_t>("uint32_t", 1000);
+    benchmark_heap<uint32_t>("uint32_t", 100000);
+    benchmark_heap<LargeElement>("128 bytes", 1000);
+    benchmark_heap<LargeElement>("128 bytes", 100000);
+}
+
+static void benchmark_bulk_insert() {
+    const size_t n = 100000;
+    UAllocTraits_t traits = {0};
+    uint32_t *values = new uint32_t[n];
+    uint32_t seed = 1;
+    for (size_t i = 0; i < n; i ++) {
+        seed = seed * 1103515245 + 12345;
+        values[i] = seed >> 8;
+    }
+    struct timespec t0, t1, t2, t3;
+    BinaryHeap<uint32_t> h1, h2, h3;
+    TEST_ASSERT_TRUE(h1.init(n, n, traits, sizeof(uint32_t)));
+    TEST_ASSERT_TRUE(h2.init(n, n, traits, sizeof(uint32_t)));
+    TEST_ASSERT_TRUE(h3.init(n, n, traits, sizeof(uint32_t)));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < n; i ++) {
+        h1.insert(values[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TEST_ASSERT_TRUE(h2.insert_many(values, n));
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    TEST_ASSERT_TRUE(h3.build_from(values, values + n));
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    TEST_ASSERT_TRUE(h2.is_consistent());
+    TEST_ASSERT_TRUE(h3.is_consistent());
+    printf("%u elements: insert %.1f ms, insert_many %.1f ms, build_from %.1f ms\r\n", (unsigned)n,
+           (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+           (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6,
+           (t3.tv_sec - t2.tv_sec) * 1e3 + (t3.tv_nsec - t2.tv_nsec) / 1e6);
+    delete[] values;
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
 static status_t test_setup(const size_t number_of_cases) {
     GREENTEA_SETUP(5, "default_auto");
 
@@ -179,7 +366,13 @@ static Case cases[] = {
     Case("BinaryHeap  - test_min_heap_pod", test_min_heap_pod, greentea_failure_handler),
     Case("BinaryHeap  - test_max_heap_pod", test_max_heap_pod, greentea_failure_handler),
     Case("BinaryHeap  - test_min_heap_non_pod", test_min_heap_non_pod, greentea_failure_handler),
-    Case("BinaryHeap  - test_max_heap_non_pod", test_max_heap_non_pod, greentea_failure_handler)
+    Case("BinaryHeap  - test_max_heap_non_pod", test_max_heap_non_pod, greentea_failure_handler),
+    Case("BinaryHeap  - test_remove_any", test_remove_any, greentea_failure_handler),
+    Case("BinaryHeap  - test_bulk_insert", test_bulk_insert, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("BinaryHeap  - benchmark", benchmark_binary_heap, greentea_failure_handler),
+    Case("BinaryHeap  - benchmark bulk insert", benchmark_bulk_insert, greentea_failure_handler),
+#endif
 };
 
 static Specification specification(test_setup, cases, greentea_test_teardown_handler);
@@ -0,0 +1,259 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/DaryHeap.h"
+#include "core-util/BinaryHeap.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+struct Test {
+    Test(int a = 0, uint8_t c = 10): _a(a), _c(c) {
+        inst_count ++;
+    }
+
+    Test(const Test& t): _a(t._a), _c(t._c) {
+        inst_count ++;
+    }
+
+    Test& operator =(const Test& t) {
+        _a = t._a;
+        _c = t._c;
+        return *this;
+    }
+
+    ~Test() {
+        inst_count --;
+    }
+
+    bool operator ==(const Test& t) const {
+        return (t._a == _a) && (t._c == _c);
+    }
+
+    bool operator <=(const Test& t) const {
+        return _a <= t._a;
+    }
+
+    bool operator >=(const Test& t) const {
+        return _a >= t._a;
+    }
+
+    int _a;
+    uint8_t _c;
+    static int inst_count;
+};
+int Test::inst_count = 0;
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+template <unsigned D>
+static void test_min_heap() {
+    DaryHeap<int, D> heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(5, 7, traits));
+    TEST_ASSERT_EQUAL(D, heap.get_arity());
+
+    const int data[] = {20, 13, 8, 7, 100, -50, 0, 16, 1000, 2, 13, -7, 55, 9, 8};
+    const int sorted_data[] = {-50, -7, 0, 2, 7, 8, 8, 9, 13, 13, 16, 20, 55, 100, 1000};
+    const unsigned data_size = sizeof(data) / sizeof(data[0]);
+    for (unsigned i = 0; i < data_size; i ++) {
+        TEST_ASSERT_TRUE(heap.insert(data[i]));
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_EQUAL(data_size, heap.get_num_elements());
+    for (unsigned i = 0; i < data_size; i ++) {
+        TEST_ASSERT_EQUAL(sorted_data[i], heap.get_root());
+        TEST_ASSERT_EQUAL(sorted_data[i], heap.pop_root());
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_TRUE(heap.is_empty());
+
+    // Removing elements by value
+    for (unsigned i = 0; i < data_size; i ++) {
+        TEST_ASSERT_TRUE(heap.insert(data[i]));
+    }
+    const int to_remove[] = {1000, -50, 13, 8, 20};
+    const int sorted_after_remove[] = {-7, 0, 2, 7, 8, 9, 13, 16, 55, 100};
+    for (unsigned i = 0; i < sizeof(to_remove) / sizeof(to_remove[0]); i ++) {
+        TEST_ASSERT_TRUE(heap.remove(to_remove[i]));
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_FALSE(heap.remove(2000));
+    for (unsigned i = 0; i < sizeof(sorted_after_remove) / sizeof(sorted_after_remove[0]); i ++) {
+        TEST_ASSERT_EQUAL(sorted_after_remove[i], heap.pop_root());
+    }
+    TEST_ASSERT_TRUE(heap.is_empty());
+}
+
+template <unsigned D>
+static void test_max_heap_non_pod() {
+    {
+    DaryHeap<Test, D, MaxCompare<Test> > heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(4, 16, traits));
+    uint32_t seed = D;
+    for (unsigned i = 0; i < 500; i ++) {
+        uint32_t r = next_random(seed);
+        TEST_ASSERT_TRUE(heap.insert(Test(r % 200, i % 3)));
+        if (i % 4 == 3) {
+            TEST_ASSERT_TRUE(heap.remove(Test(r % 200, i % 3)));
+        }
+        if (i % 5 == 4) {
+            heap.remove_root();
+        }
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_EQUAL(275, heap.get_num_elements());
+    TEST_ASSERT_EQUAL(275, Test::inst_count);
+    int last = heap.get_root()._a;
+    while (!heap.is_empty()) {
+        Test t = heap.pop_root();
+        TEST_ASSERT_TRUE(t._a <= last);
+        last = t._a;
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+template <unsigned D>
+static void test_bulk_insert() {
+    DaryHeap<int, D> heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(4, 16, traits));
+    uint32_t seed = D;
+    int values[100];
+    for (unsigned i = 0; i < 100; i ++) {
+        values[i] = next_random(seed) % 1000;
+    }
+
+    // Few elements in a larger heap (sifted up one by one), then more elements than the heap has
+    // (bottom-up heapify)
+    for (unsigned i = 0; i < 10; i ++) {
+        TEST_ASSERT_TRUE(heap.insert(values[i]));
+    }
+    TEST_ASSERT_TRUE(heap.insert_many(values + 10, 5));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_TRUE(heap.insert_many(values + 15, 85));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(100, heap.get_num_elements());
+    int last = heap.pop_root();
+    while (!heap.is_empty()) {
+        int v = heap.pop_root();
+        TEST_ASSERT_TRUE(last <= v);
+        last = v;
+    }
+
+    // build_from replaces the contents of the heap
+    TEST_ASSERT_TRUE(heap.insert(-1));
+    TEST_ASSERT_TRUE(heap.build_from(values, values + 50));
+    TEST_ASSERT_EQUAL(50, heap.get_num_elements());
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_FALSE(heap.remove(-1));
+}
+
+static void test_dary_heap() {
+    test_min_heap<2>();
+    test_min_heap<3>();
+    test_min_heap<4>();
+    test_min_heap<8>();
+}
+
+static void test_dary_heap_bulk_insert() {
+    test_bulk_insert<2>();
+    test_bulk_insert<3>();
+    test_bulk_insert<8>();
+}
+
+static void test_dary_heap_non_pod() {
+    test_max_heap_non_pod<2>();
+    test_max_heap_non_pod<4>();
+    test_max_heap_non_pod<8>();
+}
+
+#if defined(TARGET_LIKE_POSIX)
+template <typename Heap>
+static void benchmark_heap(const char *name, size_t n) {
+    Heap heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(1024, 1024, traits, sizeof(uint32_t)));
+    uint32_t seed = 1;
+    struct timespec t0, t1, t2;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < n; i ++) {
+        heap.insert(next_random(seed));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (size_t i = 0; i < n; i ++) {
+        heap.remove_root();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    TEST_ASSERT_TRUE(heap.is_empty());
+    double insert_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+    double pop_ns = ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) / n;
+    printf("%14s %10u %14.1f %14.1f\r\n", name, (unsigned)n, insert_ns, pop_ns);
+}
+
+static void benchmark_dary_heap() {
+    const size_t sizes[] = {1000, 30000, 300000};
+
+    printf("%14s %10s %14s %14s\r\n", "heap", "elements", "insert (ns)", "pop (ns)");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i ++) {
+        benchmark_heap<BinaryHeap<uint32_t> >("BinaryHeap", sizes[i]);
+        benchmark_heap<DaryHeap<uint32_t, 4> >("DaryHeap<4>", sizes[i]);
+        benchmark_heap<DaryHeap<uint32_t, 8> >("DaryHeap<8>", sizes[i]);
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("DaryHeap  - min heap", test_dary_heap, greentea_failure_handler),
+    Case("DaryHeap  - max heap, non POD", test_dary_heap_non_pod, greentea_failure_handler),
+    Case("DaryHeap  - bulk insert", test_dary_heap_bulk_insert, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("DaryHeap  - benchmark", benchmark_dary_heap, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -22,6 +22,10 @@
 #include "ualloc/ualloc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#include <pthread.h>
+#endif
 
 using namespace utest::v1;
 using namespace mbed::util;
@@ -64,6 +68,398 @@ static void test_extendable_pool_allocator() {
     TEST_ASSERT_EQUAL(2, allocator.get_num_pools());
 }
 
+static void test_extendable_pool_allocator_many_pools() {
+    const size_t new_pool_elements = 3, element_size = 8, num_pools = 200;
+    const size_t total = num_pools * new_pool_elements;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(new_pool_elements, new_pool_elements, element_size, traits));
+
+    void **blocks = (void**)malloc(total * sizeof(void*));
+    TEST_ASSERT_TRUE(blocks != NULL);
+    for (size_t i = 0; i < total; i ++) {
+        blocks[i] = allocator.alloc();
+        TEST_ASSERT_TRUE(check_value_and_alignment(blocks[i]));
+    }
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+
+    // Free every other element, in an order that jumps between old and new pools
+    for (size_t i = 0; i < total / 2; i += 2) {
+        allocator.free(blocks[i]);
+        allocator.free(blocks[total - 1 - i]);
+    }
+    // All the freed elements must be reusable without creating new pools
+    for (size_t i = 0; i < total / 2; i += 2) {
+        TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+        TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    }
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+    // Freeing a pointer that doesn't belong to the allocator has no effect
+    allocator.free(blocks);
+    allocator.alloc();
+    TEST_ASSERT_EQUAL(num_pools + 1, allocator.get_num_pools());
+    free(blocks);
+}
+
+static void test_extendable_pool_allocator_nonfull_table() {
+    // An old pool that goes from full to non-full over and over is kept in the table of pools
+    // with free space only once
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(4, 4, 8, traits));
+    void *blocks[8];
+    for (unsigned i = 0; i < 8; i ++) {
+        blocks[i] = allocator.alloc();
+        TEST_ASSERT_TRUE(check_value_and_alignment(blocks[i]));
+    }
+    TEST_ASSERT_EQUAL(2, allocator.get_num_pools());
+    for (unsigned cycle = 0; cycle < 20; cycle ++) {
+        // blocks[1] is in the old pool, the most recent pool is full
+        allocator.free(blocks[1]);
+        TEST_ASSERT_TRUE(allocator.is_consistent());
+        TEST_ASSERT_EQUAL(blocks[1], allocator.alloc());
+        TEST_ASSERT_TRUE(allocator.is_consistent());
+    }
+    // The table still finds the free space of both pools
+    allocator.free(blocks[2]);
+    allocator.free(blocks[6]);
+    TEST_ASSERT_TRUE(allocator.is_consistent());
+    TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    TEST_ASSERT_EQUAL(2, allocator.get_num_pools());
+    TEST_ASSERT_TRUE(allocator.is_consistent());
+}
+
+static void test_extendable_pool_allocator_trim() {
+    const size_t pool_elements = 4, element_size = 8, num_pools = 5;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(pool_elements, pool_elements, element_size, traits));
+    TEST_ASSERT_EQUAL(1, allocator.get_num_empty_pools());
+
+    void *blocks[num_pools][pool_elements];
+    for (size_t i = 0; i < num_pools; i ++) {
+        for (size_t j = 0; j < pool_elements; j ++) {
+            blocks[i][j] = allocator.alloc();
+            TEST_ASSERT_TRUE(check_value_and_alignment(blocks[i][j]));
+        }
+    }
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(0, allocator.get_num_empty_pools());
+    TEST_ASSERT_EQUAL(0, allocator.trim());
+
+    // Empty pools 1 and 3, and part of pool 2
+    for (size_t j = 0; j < pool_elements; j ++) {
+        allocator.free(blocks[1][j]);
+        allocator.free(blocks[3][j]);
+    }
+    allocator.free(blocks[2][0]);
+    TEST_ASSERT_EQUAL(2, allocator.get_num_empty_pools());
+
+    // Keep the most recent empty pool, then release everything
+    TEST_ASSERT_EQUAL(1, allocator.trim(1));
+    TEST_ASSERT_EQUAL(num_pools - 1, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(1, allocator.get_num_empty_pools());
+    TEST_ASSERT_EQUAL(1, allocator.trim());
+    TEST_ASSERT_EQUAL(num_pools - 2, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(0, allocator.get_num_empty_pools());
+
+    // The elements of the remaining pools can still be freed and reused
+    allocator.free(blocks[4][1]);
+    allocator.free(blocks[0][3]);
+    void *p1 = allocator.alloc(), *p2 = allocator.alloc(), *p3 = allocator.alloc();
+    TEST_ASSERT_TRUE((p1 == blocks[4][1]) || (p1 == blocks[0][3]) || (p1 == blocks[2][0]));
+    TEST_ASSERT_TRUE((p2 == blocks[4][1]) || (p2 == blocks[0][3]) || (p2 == blocks[2][0]));
+    TEST_ASSERT_TRUE((p3 == blocks[4][1]) || (p3 == blocks[0][3]) || (p3 == blocks[2][0]));
+    TEST_ASSERT_EQUAL(num_pools - 2, allocator.get_num_pools());
+    allocator.alloc();
+    TEST_ASSERT_EQUAL(num_pools - 1, allocator.get_num_pools());
+
+    // Releasing everything still leaves one pool
+    ExtendablePoolAllocator allocator2;
+    TEST_ASSERT_TRUE(allocator2.init(pool_elements, pool_elements, element_size, traits));
+    TEST_ASSERT_EQUAL(0, allocator2.trim());
+    TEST_ASSERT_EQUAL(1, allocator2.get_num_pools());
+}
+
+static void test_extendable_pool_allocator_trim_watermarks() {
+    const size_t pool_elements = 2, element_size = 8, num_pools = 6;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(pool_elements, pool_elements, element_size, traits));
+    allocator.set_trim_watermarks(3, 1);
+
+    void *blocks[num_pools * pool_elements];
+    for (size_t i = 0; i < num_pools * pool_elements; i ++) {
+        blocks[i] = allocator.alloc();
+    }
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+
+    // Up to 3 empty pools are tolerated
+    for (size_t i = 0; i < 3 * pool_elements; i ++) {
+        allocator.free(blocks[i]);
+    }
+    TEST_ASSERT_FALSE(allocator.needs_trim());
+    TEST_ASSERT_EQUAL(0, allocator.trim_if_needed());
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(3, allocator.get_num_empty_pools());
+
+    // The 4th empty pool crosses the high watermark, but free() never releases pools by itself
+    allocator.free(blocks[3 * pool_elements]);
+    allocator.free(blocks[3 * pool_elements + 1]);
+    TEST_ASSERT_TRUE(allocator.needs_trim());
+    TEST_ASSERT_EQUAL(num_pools, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(4, allocator.get_num_empty_pools());
+
+    // Trimming goes down to a single empty pool
+    TEST_ASSERT_EQUAL(3, allocator.trim_if_needed());
+    TEST_ASSERT_FALSE(allocator.needs_trim());
+    TEST_ASSERT_EQUAL(num_pools - 3, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(1, allocator.get_num_empty_pools());
+
+    // Release the last pool that an element was freed to, then allocate again
+    TEST_ASSERT_EQUAL(1, allocator.trim());
+    TEST_ASSERT_EQUAL(num_pools - 4, allocator.get_num_pools());
+    TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    TEST_ASSERT_EQUAL(num_pools - 3, allocator.get_num_pools());
+}
+
+// Allocate until a new pool is created, return the number of allocations from the previous pools
+static size_t fill_until_next_pool(ExtendablePoolAllocator& allocator) {
+    const unsigned pools = allocator.get_num_pools();
+    size_t cnt = 0;
+    while (true) {
+        TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+        if (allocator.get_num_pools() != pools)
+            return cnt;
+        cnt ++;
+    }
+}
+
+static void test_extendable_pool_allocator_geometric_growth() {
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(10, 4, 8, traits));
+    allocator.set_geometric_growth(32);
+
+    // Pool sizes: 10 (initial), 4, 8, 16, 32, 32
+    TEST_ASSERT_EQUAL(10, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(4 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(8 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(16 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(32 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(32 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(7, allocator.get_num_pools());
+
+    // Back to fixed size pools
+    allocator.set_fixed_growth();
+    TEST_ASSERT_EQUAL(32 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(4 - 1, fill_until_next_pool(allocator));
+}
+
+static size_t growth_callback(unsigned num_pools, size_t last_pool_elements) {
+    // Grow by 5 more elements for each existing pool, stop after 4 pools
+    return num_pools < 4 ? last_pool_elements + 5 * num_pools : 0;
+}
+
+struct growth_limiter {
+    // Grow with pools of 'elements' elements until 'max_pools' pools exist
+    size_t next_pool(unsigned num_pools, size_t) {
+        calls ++;
+        return num_pools < max_pools ? elements : 0;
+    }
+
+    unsigned max_pools, calls;
+    size_t elements;
+};
+
+static void test_extendable_pool_allocator_growth_callback() {
+    UAllocTraits_t traits = {0};
+    {
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(2, 4, 8, traits));
+    allocator.set_growth_callback(growth_callback);
+
+    // Pool sizes: 2 (initial), 7, 17, 32, then no more pools
+    TEST_ASSERT_EQUAL(2, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(7 - 1, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(17 - 1, fill_until_next_pool(allocator));
+    for (size_t i = 0; i < 32 - 1; i ++) {
+        TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    }
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    TEST_ASSERT_EQUAL(4, allocator.get_num_pools());
+    }
+
+    // Member function callback
+    ExtendablePoolAllocator allocator;
+    TEST_ASSERT_TRUE(allocator.init(2, 4, 8, traits));
+    growth_limiter limiter = {3, 0, 10};
+    allocator.set_growth_callback(&limiter, &growth_limiter::next_pool);
+    TEST_ASSERT_EQUAL(2, fill_until_next_pool(allocator));
+    TEST_ASSERT_EQUAL(10 - 1, fill_until_next_pool(allocator));
+    for (size_t i = 0; i < 10 - 1; i ++) {
+        TEST_ASSERT_TRUE(check_value_and_alignment(allocator.alloc()));
+    }
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    TEST_ASSERT_EQUAL(3, allocator.get_num_pools());
+    TEST_ASSERT_EQUAL(3, limiter.calls);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+namespace {
+
+const unsigned growth_threads = 8, growth_allocs_per_thread = 2000;
+
+struct growth_thread {
+    ExtendablePoolAllocator *allocator;
+    void **blocks;
+};
+
+void *growth_thread_main(void *arg) {
+    growth_thread *t = (growth_thread*)arg;
+    for (unsigned i = 0; i < growth_allocs_per_thread; i ++)
+        t->blocks[i] = t->allocator->alloc();
+    return NULL;
+}
+
+int compare_pointers(const void *p1, const void *p2) {
+    uintptr_t a = *(const uintptr_t*)p1, b = *(const uintptr_t*)p2;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+} // namespace
+
+static void test_extendable_pool_allocator_concurrent_growth() {
+    const size_t total = growth_threads * growth_allocs_per_thread;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    // Tiny pools, so that the threads keep racing to create new ones
+    TEST_ASSERT_TRUE(allocator.init(2, 2, 8, traits));
+
+    void **blocks = (void**)malloc(total * sizeof(void*));
+    TEST_ASSERT_TRUE(blocks != NULL);
+    pthread_t threads[growth_threads];
+    growth_thread args[growth_threads];
+    for (unsigned i = 0; i < growth_threads; i ++) {
+        args[i].allocator = &allocator;
+        args[i].blocks = blocks + i * growth_allocs_per_thread;
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, growth_thread_main, &args[i]));
+    }
+    for (unsigned i = 0; i < growth_threads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Every allocation succeeded and no element was handed out twice
+    qsort(blocks, total, sizeof(void*), compare_pointers);
+    for (size_t i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(check_value_and_alignment(blocks[i]));
+        if (i > 0)
+            TEST_ASSERT_TRUE(blocks[i] != blocks[i - 1]);
+    }
+    // All the pools are full, except for the ones created by threads that lost a race
+    TEST_ASSERT_TRUE(allocator.get_num_pools() >= total / 2);
+    for (size_t i = 0; i < total; i ++)
+        allocator.free(blocks[i]);
+    TEST_ASSERT_EQUAL(allocator.get_num_pools(), allocator.get_num_empty_pools());
+    free(blocks);
+}
+
+static void benchmark_extendable_pool_allocator_free() {
+    const size_t new_pool_elements = 4, element_size = 16;
+    const unsigned pool_counts[] = {1, 16, 64, 256, 1024};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %14s\r\n", "pools", "free() (ns)");
+    for (size_t k = 0; k < sizeof(pool_counts) / sizeof(pool_counts[0]); k ++) {
+        const size_t total = pool_counts[k] * new_pool_elements;
+        ExtendablePoolAllocator allocator;
+        TEST_ASSERT_TRUE(allocator.init(new_pool_elements, new_pool_elements, element_size, traits));
+        void **blocks = (void**)malloc(total * sizeof(void*));
+        TEST_ASSERT_TRUE(blocks != NULL);
+        for (size_t i = 0; i < total; i ++)
+            blocks[i] = allocator.alloc();
+        TEST_ASSERT_EQUAL(pool_counts[k], allocator.get_num_pools());
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        // Free the oldest elements first (the worst case for a walk from the newest pool)
+        for (size_t i = 0; i < total; i ++)
+            allocator.free(blocks[i]);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        printf("%10u %14.1f\r\n", allocator.get_num_pools(), ns / total);
+        free(blocks);
+    }
+}
+
+static void benchmark_extendable_pool_allocator_alloc() {
+    const size_t new_pool_elements = 4, element_size = 16, iterations = 100000;
+    const unsigned pool_counts[] = {1, 16, 64, 256, 1024};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %24s\r\n", "pools", "alloc() + free() (ns)");
+    for (size_t k = 0; k < sizeof(pool_counts) / sizeof(pool_counts[0]); k ++) {
+        const size_t total = pool_counts[k] * new_pool_elements;
+        ExtendablePoolAllocator allocator;
+        TEST_ASSERT_TRUE(allocator.init(new_pool_elements, new_pool_elements, element_size, traits));
+        void *first = allocator.alloc();
+        for (size_t i = 1; i < total; i ++)
+            allocator.alloc();
+        // Steady state with a single hole in the oldest pool
+        allocator.free(first);
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t i = 0; i < iterations; i ++) {
+            void *p = allocator.alloc();
+            allocator.free(p);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        TEST_ASSERT_EQUAL(pool_counts[k], allocator.get_num_pools());
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        printf("%10u %24.1f\r\n", allocator.get_num_pools(), ns / iterations);
+    }
+}
+
+static void benchmark_extendable_pool_allocator_alloc_fragmented() {
+    const size_t new_pool_elements = 4, element_size = 16, rounds = 20;
+    const unsigned pool_counts[] = {1, 16, 64, 256, 1024};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %24s\r\n", "pools", "alloc() + free() (ns)");
+    for (size_t k = 0; k < sizeof(pool_counts) / sizeof(pool_counts[0]); k ++) {
+        const size_t total = pool_counts[k] * new_pool_elements;
+        ExtendablePoolAllocator allocator;
+        TEST_ASSERT_TRUE(allocator.init(new_pool_elements, new_pool_elements, element_size, traits));
+        void **blocks = (void**)malloc(total * sizeof(void*));
+        TEST_ASSERT_TRUE(blocks != NULL);
+        for (size_t i = 0; i < total; i ++)
+            blocks[i] = allocator.alloc();
+        // One hole in every pool, so the holes can't all be remembered at the same time
+        void **holes = (void**)malloc(pool_counts[k] * sizeof(void*));
+        TEST_ASSERT_TRUE(holes != NULL);
+        for (size_t i = 0; i < pool_counts[k]; i ++)
+            allocator.free(blocks[i * new_pool_elements]);
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t r = 0; r < rounds; r ++) {
+            for (size_t i = 0; i < pool_counts[k]; i ++)
+                holes[i] = allocator.alloc();
+            for (size_t i = 0; i < pool_counts[k]; i ++)
+                allocator.free(holes[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        TEST_ASSERT_EQUAL(pool_counts[k], allocator.get_num_pools());
+        double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+        printf("%10u %24.1f\r\n", allocator.get_num_pools(), ns / (rounds * pool_counts[k]));
+        free(holes);
+        free(blocks);
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
 static status_t test_setup(const size_t number_of_cases) {
     GREENTEA_SETUP(5, "default_auto");
 
@@ -71,7 +467,19 @@ static status_t test_setup(const size_t number_of_cases) {
 }
 
 static Case cases[] = {
-    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator", test_extendable_pool_allocator)
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator", test_extendable_pool_allocator),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_many_pools", test_extendable_pool_allocator_many_pools),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_nonfull_table", test_extendable_pool_allocator_nonfull_table),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_trim", test_extendable_pool_allocator_trim),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_trim_watermarks", test_extendable_pool_allocator_trim_watermarks),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_geometric_growth", test_extendable_pool_allocator_geometric_growth),
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_growth_callback", test_extendable_pool_allocator_growth_callback),
+#if defined(TARGET_LIKE_POSIX)
+    Case("ExtendablePoolAllocator  - test_extendable_pool_allocator_concurrent_growth", test_extendable_pool_allocator_concurrent_growth),
+    Case("ExtendablePoolAllocator  - benchmark_extendable_pool_allocator_free", benchmark_extendable_pool_allocator_free),
+    Case("ExtendablePoolAllocator  - benchmark_extendable_pool_allocator_alloc", benchmark_extendable_pool_allocator_alloc),
+    Case("ExtendablePoolAllocator  - benchmark_extendable_pool_allocator_alloc_fragmented", benchmark_extendable_pool_allocator_alloc_fragmented),
+#endif
 };
 
 static Specification specification(test_setup, cases, greentea_test_teardown_handler);
@@ -0,0 +1,281 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/IndexedHeap.h"
+#include "core-util/BinaryHeap.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+typedef IndexedHeap<int> IntHeap;
+
+struct Test {
+    Test(int a = 0): _a(a) {
+        inst_count ++;
+    }
+
+    Test(const Test& t): _a(t._a) {
+        inst_count ++;
+    }
+
+    Test& operator =(const Test& t) {
+        _a = t._a;
+        return *this;
+    }
+
+    ~Test() {
+        inst_count --;
+    }
+
+    bool operator >=(const Test& t) const {
+        return _a >= t._a;
+    }
+
+    int _a;
+    static int inst_count;
+};
+int Test::inst_count = 0;
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+static void test_handles() {
+    IntHeap heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(4, 4, traits));
+    TEST_ASSERT_EQUAL(IntHeap::invalid_handle, heap.get_root_handle());
+
+    const int data[] = {20, 13, 8, 7, 100, -50, 0, 16, 1000, 2};
+    const unsigned data_size = sizeof(data) / sizeof(data[0]);
+    IntHeap::handle_t handles[data_size];
+    for (unsigned i = 0; i < data_size; i ++) {
+        handles[i] = heap.insert(data[i]);
+        TEST_ASSERT_TRUE(handles[i] != IntHeap::invalid_handle);
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    // The handles follow the elements around the heap
+    for (unsigned i = 0; i < data_size; i ++) {
+        TEST_ASSERT_TRUE(heap.contains(handles[i]));
+        TEST_ASSERT_EQUAL(data[i], heap.get(handles[i]));
+    }
+    TEST_ASSERT_EQUAL(-50, heap.get_root());
+    TEST_ASSERT_EQUAL(handles[5], heap.get_root_handle());
+
+    // Remove by handle: the root, a leaf and a node in the middle
+    TEST_ASSERT_TRUE(heap.remove(handles[5]));
+    TEST_ASSERT_TRUE(heap.remove(handles[8]));
+    TEST_ASSERT_TRUE(heap.remove(handles[1]));
+    TEST_ASSERT_FALSE(heap.remove(handles[1]));
+    TEST_ASSERT_FALSE(heap.contains(handles[1]));
+    TEST_ASSERT_FALSE(heap.remove(1000));
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(7, heap.get_num_elements());
+
+    // Decrease and increase keys
+    TEST_ASSERT_TRUE(heap.update_key(handles[4], -1));  // 100 -> -1
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_EQUAL(handles[4], heap.get_root_handle());
+    TEST_ASSERT_TRUE(heap.update_key(handles[4], 50));  // -1 -> 50
+    TEST_ASSERT_TRUE(heap.update_key(handles[6], 17));  // 0 -> 17
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_FALSE(heap.update_key(handles[5], 3));
+
+    // The entries of removed handles are reused, but with a different handle
+    IntHeap::handle_t h = heap.insert(5);
+    TEST_ASSERT_TRUE((h != handles[5]) && (h != handles[8]) && (h != handles[1]));
+    TEST_ASSERT_EQUAL(5, heap.get(h));
+    TEST_ASSERT_FALSE(heap.contains(handles[5]) || heap.contains(handles[8]) || heap.contains(handles[1]));
+
+    const int sorted[] = {2, 5, 7, 8, 16, 17, 20, 50};
+    for (unsigned i = 0; i < sizeof(sorted) / sizeof(sorted[0]); i ++) {
+        TEST_ASSERT_EQUAL(sorted[i], heap.pop_root());
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    TEST_ASSERT_TRUE(heap.is_empty());
+    TEST_ASSERT_EQUAL(IntHeap::invalid_handle, heap.get_root_handle());
+}
+
+static void test_stale_handles() {
+    // A timer fires (its element is popped), then its owner tries to cancel it: the stale handle
+    // must not cancel the timer that reused its entry
+    IntHeap heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(4, 4, traits));
+    IntHeap::handle_t fired = heap.insert(100);
+    TEST_ASSERT_EQUAL(100, heap.pop_root());
+    IntHeap::handle_t other = heap.insert(200);
+    TEST_ASSERT_TRUE(other != fired);
+    TEST_ASSERT_FALSE(heap.contains(fired));
+    TEST_ASSERT_FALSE(heap.remove(fired));
+    TEST_ASSERT_FALSE(heap.update_key(fired, 10));
+    TEST_ASSERT_TRUE(heap.contains(other));
+    TEST_ASSERT_EQUAL(200, heap.get(other));
+    TEST_ASSERT_EQUAL(1, heap.get_num_elements());
+
+    // Every reuse of the same entry gives a new handle, and only the last one is valid
+    IntHeap::handle_t previous = other;
+    for (unsigned i = 0; i < 1000; i ++) {
+        TEST_ASSERT_TRUE(heap.remove(previous));
+        IntHeap::handle_t h = heap.insert(i);
+        TEST_ASSERT_TRUE(h != previous);
+        TEST_ASSERT_FALSE(heap.contains(previous));
+        TEST_ASSERT_FALSE(heap.contains(fired));
+        TEST_ASSERT_TRUE(heap.contains(h));
+        previous = h;
+    }
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    TEST_ASSERT_FALSE(heap.contains(IntHeap::invalid_handle));
+}
+
+static void test_random_non_pod() {
+    {
+    const unsigned count = 300;
+    IndexedHeap<Test, MaxCompare<Test> > heap;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(heap.init(8, 32, traits));
+    IndexedHeap<Test, MaxCompare<Test> >::handle_t handles[count];
+    int values[count];
+    bool live[count];
+    uint32_t seed = 3;
+
+    for (unsigned i = 0; i < count; i ++) {
+        values[i] = next_random(seed) % 1000;
+        handles[i] = heap.insert(Test(values[i]));
+        live[i] = true;
+    }
+    TEST_ASSERT_TRUE(heap.is_consistent());
+    // Random updates and removes
+    for (unsigned step = 0; step < 1000; step ++) {
+        unsigned i = next_random(seed) % count;
+        if (!live[i])
+            continue;
+        if (step % 3 == 0) {
+            TEST_ASSERT_TRUE(heap.remove(handles[i]));
+            live[i] = false;
+        } else {
+            values[i] = next_random(seed) % 1000;
+            TEST_ASSERT_TRUE(heap.update_key(handles[i], Test(values[i])));
+        }
+        TEST_ASSERT_TRUE(heap.is_consistent());
+    }
+    unsigned remaining = 0;
+    for (unsigned i = 0; i < count; i ++) {
+        if (live[i]) {
+            TEST_ASSERT_EQUAL(values[i], heap.get(handles[i])._a);
+            remaining ++;
+        }
+    }
+    TEST_ASSERT_EQUAL(remaining, heap.get_num_elements());
+    TEST_ASSERT_EQUAL(remaining, Test::inst_count);
+    int last = heap.get_root()._a;
+    while (!heap.is_empty()) {
+        Test t = heap.pop_root();
+        TEST_ASSERT_TRUE(t._a <= last);
+        last = t._a;
+    }
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+// Insert 'n' timeouts, then cancel all of them in random order
+static void benchmark_cancel() {
+    const size_t sizes[] = {1000, 10000};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %24s %24s\r\n", "elements", "BinaryHeap::remove (ns)", "IndexedHeap::remove (ns)");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s ++) {
+        const size_t n = sizes[s];
+        uint32_t *values = new uint32_t[n];
+        IntHeap::handle_t *handles = new IntHeap::handle_t[n];
+        BinaryHeap<uint32_t> bheap;
+        IndexedHeap<uint32_t> iheap;
+        TEST_ASSERT_TRUE(bheap.init(n, n, traits, sizeof(uint32_t)));
+        TEST_ASSERT_TRUE(iheap.init(n, n, traits));
+        uint32_t seed = 5;
+        for (size_t i = 0; i < n; i ++) {
+            values[i] = next_random(seed);
+            bheap.insert(values[i]);
+            handles[i] = iheap.insert(values[i]);
+        }
+        // Shuffle the cancellation order
+        for (size_t i = n - 1; i > 0; i --) {
+            size_t j = next_random(seed) % (i + 1);
+            uint32_t v = values[i];
+            values[i] = values[j];
+            values[j] = v;
+            IntHeap::handle_t h = handles[i];
+            handles[i] = handles[j];
+            handles[j] = h;
+        }
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t i = 0; i < n; i ++) {
+            bheap.remove(values[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (size_t i = 0; i < n; i ++) {
+            iheap.remove(handles[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        TEST_ASSERT_TRUE(bheap.is_empty());
+        TEST_ASSERT_TRUE(iheap.is_empty());
+        double b_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+        double i_ns = ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) / n;
+        printf("%10u %24.1f %24.1f\r\n", (unsigned)n, b_ns, i_ns);
+        delete[] values;
+        delete[] handles;
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("IndexedHeap  - handles", test_handles, greentea_failure_handler),
+    Case("IndexedHeap  - stale handles", test_stale_handles, greentea_failure_handler),
+    Case("IndexedHeap  - random updates, non POD", test_random_non_pod, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("IndexedHeap  - benchmark cancel", benchmark_cancel, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -0,0 +1,298 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/MultiQueue.h"
+#include "core-util/atomic_ops.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+// Elements are copied by several threads, so the instance count is atomic
+struct Test {
+    Test(int a = 0): _a(a) {
+        atomic_incr(&inst_count, (uint32_t)1);
+    }
+
+    Test(const Test& t): _a(t._a) {
+        atomic_incr(&inst_count, (uint32_t)1);
+    }
+
+    Test& operator =(const Test& t) {
+        _a = t._a;
+        return *this;
+    }
+
+    ~Test() {
+        atomic_decr(&inst_count, (uint32_t)1);
+    }
+
+    bool operator <=(const Test& t) const {
+        return _a <= t._a;
+    }
+
+    int _a;
+    static uint32_t inst_count;
+};
+uint32_t Test::inst_count = 0;
+
+static uint32_t next_random(uint32_t &state) {
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+static void test_single_queue() {
+    // With a single sub-queue, the ordering is strict
+    MultiQueue<int, MaxCompare<int> > queue;
+    UAllocTraits_t traits = {0};
+    int value;
+    TEST_ASSERT_FALSE(queue.insert(1));
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_FALSE(queue.init(0, 4, 4, traits));
+    TEST_ASSERT_TRUE(queue.init(1, 4, 4, traits));
+    TEST_ASSERT_FALSE(queue.init(1, 4, 4, traits));
+    TEST_ASSERT_EQUAL(1, queue.get_num_queues());
+
+    const int data[] = {20, 13, 8, 7, 100, -50, 0, 16, 1000, 2};
+    const int sorted[] = {1000, 100, 20, 16, 13, 8, 7, 2, 0, -50};
+    for (unsigned i = 0; i < sizeof(data) / sizeof(data[0]); i ++) {
+        TEST_ASSERT_TRUE(queue.insert(data[i]));
+        TEST_ASSERT_TRUE(queue.is_consistent());
+    }
+    TEST_ASSERT_EQUAL(10, queue.get_num_elements());
+    for (unsigned i = 0; i < sizeof(sorted) / sizeof(sorted[0]); i ++) {
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL(sorted[i], value);
+        TEST_ASSERT_TRUE(queue.is_consistent());
+    }
+    TEST_ASSERT_TRUE(queue.is_empty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+}
+
+// A comparator that uses the queue again while the queue holds a sub-queue, like an interrupt
+// handler that interrupts an operation on the queue
+struct ReentrantCompare;
+static MultiQueue<int, ReentrantCompare> *reentrant_queue;
+static bool reentrant_pending, reentrant_insert_res, reentrant_pop_res;
+
+struct ReentrantCompare {
+    bool operator ()(int e1, int e2) const {
+        if (reentrant_pending) {
+            reentrant_pending = false;
+            int value;
+            reentrant_insert_res = reentrant_queue->insert(1000);
+            reentrant_pop_res = reentrant_queue->pop(value);
+        }
+        return e1 <= e2;
+    }
+};
+
+static void test_reentrant() {
+    // With a single sub-queue, a context that interrupts the holder of the sub-queue can't use
+    // the queue, but insert() and pop() give up instead of waiting forever
+    MultiQueue<int, ReentrantCompare> queue;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(queue.init(1, 4, 4, traits));
+    reentrant_queue = &queue;
+    TEST_ASSERT_TRUE(queue.insert(2));
+    reentrant_pending = true;
+    reentrant_insert_res = reentrant_pop_res = true;
+    TEST_ASSERT_TRUE(queue.insert(1));
+    TEST_ASSERT_FALSE(reentrant_pending);
+    TEST_ASSERT_FALSE(reentrant_insert_res);
+    TEST_ASSERT_FALSE(reentrant_pop_res);
+    TEST_ASSERT_EQUAL(2, queue.get_num_elements());
+    TEST_ASSERT_TRUE(queue.is_consistent());
+
+    // With more sub-queues, the interrupting context uses another one
+    MultiQueue<int, ReentrantCompare> multi;
+    TEST_ASSERT_TRUE(multi.init(4, 4, 4, traits));
+    reentrant_queue = &multi;
+    for (int i = 0; i < 8; i ++) {
+        TEST_ASSERT_TRUE(multi.insert(i));
+    }
+    for (unsigned i = 0; i < 8; i ++) {
+        reentrant_pending = true;
+        reentrant_insert_res = false;
+        TEST_ASSERT_TRUE(multi.insert(100 + i));
+        if (!reentrant_pending) {
+            TEST_ASSERT_TRUE(reentrant_insert_res);
+        }
+    }
+    reentrant_pending = false;
+    TEST_ASSERT_TRUE(multi.is_consistent());
+}
+
+static void test_relaxed_order() {
+    const unsigned count = 2000;
+    {
+    MultiQueue<Test> queue;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(queue.init(8, 0, 16, traits));
+    uint32_t seed = 9;
+    int64_t sum = 0;
+    for (unsigned i = 0; i < count; i ++) {
+        int v = next_random(seed) % 100000;
+        sum += v;
+        TEST_ASSERT_TRUE(queue.insert(Test(v)));
+    }
+    TEST_ASSERT_TRUE(queue.is_consistent());
+    TEST_ASSERT_EQUAL(count, queue.get_num_elements());
+    TEST_ASSERT_EQUAL(count, Test::inst_count);
+
+    // Every element comes out, roughly in order: compare the first half with the second one
+    Test t;
+    int64_t first_half = 0;
+    for (unsigned i = 0; i < count; i ++) {
+        TEST_ASSERT_TRUE(queue.pop(t));
+        sum -= t._a;
+        if (i < count / 2)
+            first_half += t._a;
+    }
+    TEST_ASSERT_TRUE(sum == 0);
+    TEST_ASSERT_TRUE(queue.is_empty());
+    TEST_ASSERT_FALSE(queue.pop(t));
+    // The average of the first half is close to 25000 (it would be 50000 without any ordering)
+    TEST_ASSERT_TRUE(first_half / (count / 2) < 30000);
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+struct worker_args {
+    MultiQueue<uint32_t> *queue;
+    uint32_t first, count;
+    uint64_t popped_sum;
+    uint32_t popped;
+};
+
+// Insert 'count' values and pop as many values (not necessarily the same ones)
+static void *worker_thread(void *arg) {
+    worker_args *args = (worker_args*)arg;
+    for (uint32_t i = 0; i < args->count; i ++) {
+        args->queue->insert(args->first + i);
+        uint32_t v;
+        if (args->queue->pop(v)) {
+            args->popped_sum += v;
+            args->popped ++;
+        }
+    }
+    return NULL;
+}
+
+static double run_workers(MultiQueue<uint32_t>& queue, unsigned threads, uint32_t per_thread, uint64_t& popped_sum, uint32_t& popped) {
+    pthread_t tids[16];
+    worker_args args[16];
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (unsigned i = 0; i < threads; i ++) {
+        worker_args a = {&queue, i * per_thread, per_thread, 0, 0};
+        args[i] = a;
+        TEST_ASSERT_EQUAL(0, pthread_create(&tids[i], NULL, worker_thread, &args[i]));
+    }
+    popped_sum = 0;
+    popped = 0;
+    for (unsigned i = 0; i < threads; i ++) {
+        pthread_join(tids[i], NULL);
+        popped_sum += args[i].popped_sum;
+        popped += args[i].popped;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void test_threads() {
+    const unsigned threads = 4;
+    const uint32_t per_thread = 20000;
+    MultiQueue<uint32_t> queue;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(queue.init(2 * threads, 64, 64, traits));
+    uint64_t popped_sum;
+    uint32_t popped;
+    run_workers(queue, threads, per_thread, popped_sum, popped);
+
+    // Every inserted value was popped exactly once, by the workers or here
+    uint32_t v;
+    while (queue.pop(v)) {
+        popped_sum += v;
+        popped ++;
+    }
+    const uint64_t total = threads * per_thread;
+    TEST_ASSERT_EQUAL(total, popped);
+    TEST_ASSERT_TRUE(popped_sum == total * (total - 1) / 2);
+    TEST_ASSERT_TRUE(queue.is_consistent());
+}
+
+static void benchmark_multi_queue() {
+    const uint32_t total = 1000000;
+    const unsigned thread_counts[] = {1, 2, 4, 8};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %10s %18s\r\n", "threads", "queues", "throughput (M/s)");
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t ++) {
+        const unsigned threads = thread_counts[t];
+        MultiQueue<uint32_t> queue;
+        TEST_ASSERT_TRUE(queue.init(2 * threads, 1024, 1024, traits));
+        // Start from a queue with some elements in it
+        for (uint32_t i = 0; i < 10000; i ++) {
+            queue.insert(i);
+        }
+        uint64_t popped_sum;
+        uint32_t popped;
+        double secs = run_workers(queue, threads, total / threads, popped_sum, popped);
+        // Each worker iteration is an insert and a pop
+        printf("%10u %10u %18.2f\r\n", threads, 2 * threads, 2.0 * total / secs / 1e6);
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("MultiQueue  - single queue", test_single_queue, greentea_failure_handler),
+    Case("MultiQueue  - reentrant use", test_reentrant, greentea_failure_handler),
+    Case("MultiQueue  - relaxed order", test_relaxed_order, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("MultiQueue  - threads", test_threads, greentea_failure_handler),
+    Case("MultiQueue  - benchmark", benchmark_multi_queue, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
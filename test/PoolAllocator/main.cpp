@@ -16,11 +16,16 @@
  */
 
 #include "core-util/PoolAllocator.h"
+#include "core-util/atomic_ops.h"
 #include "greentea-client/test_env.h"
 #include "unity/unity.h"
 #include "utest/utest.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <pthread.h>
+#endif
 
 using namespace utest::v1;
 using namespace mbed::util;
@@ -67,6 +72,189 @@ void test_pool_allocator() {
     TEST_ASSERT_EQUAL(NULL, p);
 }
 
+void test_pool_allocator_batch() {
+    const size_t elements = 10, element_size = 8;
+    void *start = malloc(PoolAllocator::get_pool_size(elements, element_size));
+    TEST_ASSERT_TRUE(start != NULL);
+    PoolAllocator allocator(start, elements, element_size);
+    void *blocks[elements + 1];
+
+    // Allocate a first burst, the blocks come in the pool order
+    TEST_ASSERT_EQUAL(4, allocator.alloc_n(blocks, 4));
+    for (size_t i = 0; i < 4; i ++) {
+        TEST_ASSERT_EQUAL((uint8_t*)start + i * element_size, blocks[i]);
+    }
+    // Ask for more than what's left
+    TEST_ASSERT_EQUAL(elements - 4, allocator.alloc_n(blocks + 4, elements));
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    TEST_ASSERT_EQUAL(0, allocator.alloc_n(blocks, 1));
+
+    // Free a burst (with a pointer that doesn't belong to the pool in the middle)
+    void *to_free[4] = {blocks[7], blocks[2], &to_free, blocks[5]};
+    allocator.free_n(to_free, 4);
+    void *p[4];
+    TEST_ASSERT_EQUAL(3, allocator.alloc_n(p, 4));
+    TEST_ASSERT_EQUAL(blocks[7], p[0]);
+    TEST_ASSERT_EQUAL(blocks[2], p[1]);
+    TEST_ASSERT_EQUAL(blocks[5], p[2]);
+
+    // Free everything and check that all the elements are available again
+    allocator.free_n(p, 3);
+    allocator.free_n(blocks, 2);
+    allocator.free(blocks[3]);
+    allocator.free_n(blocks + 4, 1);
+    allocator.free_n(blocks + 6, 1);
+    allocator.free_n(blocks + 8, 2);
+    TEST_ASSERT_EQUAL(elements, allocator.alloc_n(blocks, elements + 1));
+    for (size_t i = 0; i < elements; i ++) {
+        for (size_t j = i + 1; j < elements; j ++) {
+            TEST_ASSERT_TRUE(blocks[i] != blocks[j]);
+        }
+    }
+    free(start);
+}
+
+void test_pool_allocator_lazy() {
+    const size_t elements = 10, element_size = 8;
+    const size_t pool_size = PoolAllocator::get_pool_size(elements, element_size);
+    uint8_t *start = (uint8_t*)malloc(pool_size);
+    TEST_ASSERT_TRUE(start != NULL);
+    memset(start, 0xA5, pool_size);
+    PoolAllocator allocator(start, elements, element_size, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, true);
+
+    // The constructor must not touch the pool
+    for (size_t i = 0; i < pool_size; i ++) {
+        TEST_ASSERT_EQUAL(0xA5, start[i]);
+    }
+
+    // Elements are handed out in order from the high water mark
+    void *blocks[elements];
+    for (size_t i = 0; i < 4; i ++) {
+        blocks[i] = allocator.alloc();
+        TEST_ASSERT_EQUAL(start + i * element_size, blocks[i]);
+    }
+    // The rest of the pool is still untouched
+    for (size_t i = 4 * element_size; i < pool_size; i ++) {
+        TEST_ASSERT_EQUAL(0xA5, start[i]);
+    }
+
+    // Freed elements are reused before the untouched ones
+    allocator.free(blocks[1]);
+    TEST_ASSERT_EQUAL(blocks[1], allocator.alloc());
+
+    // A burst can take elements from both the free list and the high water mark
+    allocator.free(blocks[2]);
+    TEST_ASSERT_EQUAL(3, allocator.alloc_n(blocks + 4, 3));
+    TEST_ASSERT_EQUAL(blocks[2], blocks[4]);
+    TEST_ASSERT_EQUAL(start + 4 * element_size, blocks[5]);
+    TEST_ASSERT_EQUAL(start + 5 * element_size, blocks[6]);
+
+    // Exhaust the pool
+    TEST_ASSERT_EQUAL(elements - 6, allocator.alloc_n(blocks, elements));
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    allocator.free(start + 9 * element_size);
+    TEST_ASSERT_EQUAL(start + 9 * element_size, allocator.alloc());
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    free(start);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+namespace {
+
+const size_t stress_elements = 64, stress_element_size = 16;
+const unsigned stress_threads = 8, stress_iterations = 100000, stress_blocks_per_iteration = 4;
+
+struct stress_context {
+    PoolAllocator *allocator;
+    void *start;
+    uint32_t owners[stress_elements];
+    uint32_t errors;
+};
+
+struct stress_thread {
+    stress_context *ctx;
+    uint8_t id;
+};
+
+void *stress_thread_main(void *arg) {
+    stress_thread *t = (stress_thread*)arg;
+    stress_context *ctx = t->ctx;
+    void *blocks[stress_blocks_per_iteration];
+
+    for (unsigned i = 0; i < stress_iterations; i ++) {
+        unsigned cnt = 0;
+        while (cnt < stress_blocks_per_iteration) {
+            void *p = ctx->allocator->alloc();
+            if (p == NULL)
+                break;
+            // Claim the block: this fails if somebody else already owns it
+            uint32_t idx = ((uint8_t*)p - (uint8_t*)ctx->start) / stress_element_size, expected = 0;
+            if (!atomic_cas(&ctx->owners[idx], &expected, (uint32_t)1))
+                atomic_incr(&ctx->errors, (uint32_t)1);
+            memset(p, t->id, stress_element_size);
+            blocks[cnt ++] = p;
+        }
+        for (unsigned k = 0; k < cnt; k ++) {
+            uint8_t *p = (uint8_t*)blocks[k];
+            for (size_t j = 0; j < stress_element_size; j ++) {
+                if (p[j] != t->id) {
+                    atomic_incr(&ctx->errors, (uint32_t)1);
+                    break;
+                }
+            }
+            uint32_t idx = (p - (uint8_t*)ctx->start) / stress_element_size, expected = 1;
+            if (!atomic_cas(&ctx->owners[idx], &expected, (uint32_t)0))
+                atomic_incr(&ctx->errors, (uint32_t)1);
+            ctx->allocator->free(p);
+        }
+    }
+    return NULL;
+}
+
+} // namespace
+
+static void run_concurrent_test(bool lazy_init) {
+    size_t pool_size = PoolAllocator::get_pool_size(stress_elements, stress_element_size);
+    void *start = malloc(pool_size);
+    TEST_ASSERT_TRUE(start != NULL);
+    PoolAllocator allocator(start, stress_elements, stress_element_size, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, lazy_init);
+
+    stress_context ctx;
+    ctx.allocator = &allocator;
+    ctx.start = start;
+    memset(ctx.owners, 0, sizeof(ctx.owners));
+    ctx.errors = 0;
+
+    pthread_t threads[stress_threads];
+    stress_thread args[stress_threads];
+    for (unsigned i = 0; i < stress_threads; i ++) {
+        args[i].ctx = &ctx;
+        args[i].id = (uint8_t)(i + 1);
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, stress_thread_main, &args[i]));
+    }
+    for (unsigned i = 0; i < stress_threads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    TEST_ASSERT_EQUAL(0, ctx.errors);
+
+    // All the blocks must be back in the pool, each of them exactly once
+    for (size_t i = 0; i < stress_elements; i ++) {
+        void *p = allocator.alloc();
+        TEST_ASSERT_TRUE(p != NULL);
+        uint32_t idx = ((uint8_t*)p - (uint8_t*)start) / stress_element_size;
+        TEST_ASSERT_EQUAL(0, ctx.owners[idx]);
+        ctx.owners[idx] = 1;
+    }
+    TEST_ASSERT_EQUAL(NULL, allocator.alloc());
+    free(start);
+}
+
+void test_pool_allocator_concurrent() {
+    run_concurrent_test(false);
+    run_concurrent_test(true);
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
 static status_t test_setup(const size_t number_of_cases) {
     GREENTEA_SETUP(5, "default_auto");
 
@@ -74,7 +262,12 @@ static status_t test_setup(const size_t number_of_cases) {
 }
 
 static Case cases[] = {
-    Case("PoolAllocator  - test_pool_allocator", test_pool_allocator)
+    Case("PoolAllocator  - test_pool_allocator", test_pool_allocator),
+    Case("PoolAllocator  - test_pool_allocator_batch", test_pool_allocator_batch),
+    Case("PoolAllocator  - test_pool_allocator_lazy", test_pool_allocator_lazy),
+#if defined(TARGET_LIKE_POSIX)
+    Case("PoolAllocator  - test_pool_allocator_concurrent", test_pool_allocator_concurrent),
+#endif
 };
 
 static Specification specification(test_setup, cases, greentea_test_teardown_handler);
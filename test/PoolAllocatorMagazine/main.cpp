@@ -0,0 +1,113 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/PoolAllocatorMagazine.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+static void test_pool_allocator_magazine() {
+    const size_t elements = 10, element_size = 8;
+    void *start = malloc(PoolAllocator::get_pool_size(elements, element_size));
+    TEST_ASSERT_TRUE(start != NULL);
+    PoolAllocator pool(start, elements, element_size);
+    void *blocks[elements];
+
+    {
+        PoolAllocatorMagazine<4> magazine(pool, 2);
+
+        // The first allocation refills the magazine with a batch of 2 blocks
+        blocks[0] = magazine.alloc();
+        TEST_ASSERT_TRUE(pool.owns(blocks[0]));
+        TEST_ASSERT_EQUAL(1, magazine.get_refill_count());
+        TEST_ASSERT_EQUAL(1, magazine.get_num_cached());
+        blocks[1] = magazine.alloc();
+        TEST_ASSERT_EQUAL(1, magazine.get_refill_count());
+        TEST_ASSERT_EQUAL(0, magazine.get_num_cached());
+
+        // Exhaust the pool through the magazine
+        for (size_t i = 2; i < elements; i ++) {
+            blocks[i] = magazine.alloc();
+            TEST_ASSERT_TRUE(pool.owns(blocks[i]));
+            for (size_t j = 0; j < i; j ++) {
+                TEST_ASSERT_TRUE(blocks[i] != blocks[j]);
+            }
+        }
+        TEST_ASSERT_EQUAL(5, magazine.get_refill_count());
+        TEST_ASSERT_EQUAL(NULL, magazine.alloc());
+        TEST_ASSERT_EQUAL(NULL, pool.alloc());
+
+        // Freeing fills the magazine first, then flushes a batch to the pool
+        for (size_t i = 0; i < 4; i ++) {
+            magazine.free(blocks[i]);
+        }
+        TEST_ASSERT_EQUAL(4, magazine.get_num_cached());
+        TEST_ASSERT_EQUAL(0, magazine.get_flush_count());
+        TEST_ASSERT_EQUAL(NULL, pool.alloc());
+        magazine.free(blocks[4]);
+        TEST_ASSERT_EQUAL(1, magazine.get_flush_count());
+        TEST_ASSERT_EQUAL(3, magazine.get_num_cached());
+
+        // The flushed blocks are the least recently freed ones
+        void *p1 = pool.alloc(), *p2 = pool.alloc();
+        TEST_ASSERT_TRUE(((p1 == blocks[0]) && (p2 == blocks[1])) || ((p1 == blocks[1]) && (p2 == blocks[0])));
+        TEST_ASSERT_EQUAL(NULL, pool.alloc());
+        pool.free(p1);
+        pool.free(p2);
+
+        // The most recently freed block is reused first
+        TEST_ASSERT_EQUAL(blocks[4], magazine.alloc());
+        magazine.free(blocks[4]);
+
+        // Pointers that don't belong to the pool are ignored
+        int not_in_pool;
+        magazine.free(&not_in_pool);
+        TEST_ASSERT_EQUAL(3, magazine.get_num_cached());
+
+        for (size_t i = 5; i < elements; i ++) {
+            magazine.free(blocks[i]);
+        }
+    } // the magazine is flushed here
+
+    // All the blocks must be back in the pool
+    for (size_t i = 0; i < elements; i ++) {
+        TEST_ASSERT_TRUE(pool.alloc() != NULL);
+    }
+    TEST_ASSERT_EQUAL(NULL, pool.alloc());
+    free(start);
+}
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+static Case cases[] = {
+    Case("PoolAllocatorMagazine  - test_pool_allocator_magazine", test_pool_allocator_magazine)
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -0,0 +1,245 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/SPSCRingBuffer.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+struct Test {
+    Test(unsigned v = 0): value(v) {
+        inst_count ++;
+    }
+
+    Test(const Test& t): value(t.value) {
+        inst_count ++;
+    }
+
+    Test& operator =(const Test& t) {
+        value = t.value;
+        return *this;
+    }
+
+    ~Test() {
+        inst_count --;
+    }
+
+    unsigned value;
+    static int inst_count;
+};
+
+int Test::inst_count = 0;
+
+static void test_push_pop() {
+    UAllocTraits_t traits = {0};
+    SPSCRingBuffer<uint32_t> rb;
+    uint32_t value;
+
+    // Uninitialized buffer
+    TEST_ASSERT_FALSE(rb.push(1));
+    TEST_ASSERT_FALSE(rb.pop(value));
+    // The capacity must be a power of 2
+    TEST_ASSERT_FALSE(rb.init(0, traits));
+    TEST_ASSERT_FALSE(rb.init(12, traits));
+    TEST_ASSERT_TRUE(rb.init(8, traits));
+    TEST_ASSERT_FALSE(rb.init(8, traits));
+    TEST_ASSERT_EQUAL(8, rb.get_capacity());
+    TEST_ASSERT_TRUE(rb.is_empty());
+    TEST_ASSERT_TRUE(rb.front() == NULL);
+
+    // Go around the buffer several times
+    uint32_t next_in = 0, next_out = 0;
+    for (unsigned round = 0; round < 10; round ++) {
+        while (rb.push(next_in))
+            next_in ++;
+        TEST_ASSERT_TRUE(rb.is_full());
+        TEST_ASSERT_EQUAL(8, rb.get_num_elements());
+        for (unsigned i = 0; i < 5; i ++) {
+            TEST_ASSERT_EQUAL(next_out, *rb.front());
+            TEST_ASSERT_TRUE(rb.pop(value));
+            TEST_ASSERT_EQUAL(next_out, value);
+            next_out ++;
+        }
+        TEST_ASSERT_EQUAL(3, rb.get_num_elements());
+    }
+    while (rb.pop(value)) {
+        TEST_ASSERT_EQUAL(next_out, value);
+        next_out ++;
+    }
+    TEST_ASSERT_EQUAL(next_in, next_out);
+    TEST_ASSERT_TRUE(rb.is_empty());
+}
+
+static void test_batch() {
+    // User storage
+    uint16_t storage[16];
+    SPSCRingBuffer<uint16_t> rb;
+    TEST_ASSERT_TRUE(rb.init(16, storage));
+    uint16_t in[40], out[40];
+    for (unsigned i = 0; i < 40; i ++)
+        in[i] = i;
+
+    TEST_ASSERT_EQUAL(10, rb.push_n(in, 10));
+    TEST_ASSERT_EQUAL(6, rb.pop_n(out, 6));
+    // Only 12 free slots, and the batch wraps around the end of the storage
+    TEST_ASSERT_EQUAL(12, rb.push_n(in + 10, 20));
+    TEST_ASSERT_EQUAL(0, rb.push_n(in + 22, 1));
+    TEST_ASSERT_EQUAL(16, rb.pop_n(out + 6, 40));
+    TEST_ASSERT_EQUAL(0, rb.pop_n(out + 22, 1));
+    for (unsigned i = 0; i < 22; i ++)
+        TEST_ASSERT_EQUAL(i, out[i]);
+    for (unsigned i = 0; i < 16; i ++)
+        TEST_ASSERT_TRUE(storage[i] < 22);
+}
+
+static void test_non_pod() {
+    UAllocTraits_t traits = {0};
+    {
+        SPSCRingBuffer<Test> rb;
+        TEST_ASSERT_TRUE(rb.init(4, traits));
+        Test batch[6];
+        for (unsigned i = 0; i < 6; i ++)
+            batch[i].value = i;
+        TEST_ASSERT_EQUAL(6, Test::inst_count);
+        TEST_ASSERT_EQUAL(4, rb.push_n(batch, 6));
+        TEST_ASSERT_EQUAL(10, Test::inst_count);
+        Test t;
+        TEST_ASSERT_TRUE(rb.pop(t));
+        TEST_ASSERT_EQUAL(0, t.value);
+        TEST_ASSERT_TRUE(rb.push(Test(4)));
+        TEST_ASSERT_EQUAL(11, Test::inst_count);
+        TEST_ASSERT_EQUAL(2, rb.pop_n(batch, 2));
+        TEST_ASSERT_EQUAL(1, batch[0].value);
+        TEST_ASSERT_EQUAL(2, batch[1].value);
+        TEST_ASSERT_EQUAL(9, Test::inst_count);
+        // The remaining elements are destroyed with the buffer
+    }
+    TEST_ASSERT_EQUAL(0, Test::inst_count);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+struct transfer_args {
+    SPSCRingBuffer<uint32_t> *rb;
+    uint32_t total;
+    size_t batch;
+    bool ok;
+};
+
+static void *producer_thread(void *arg) {
+    transfer_args *args = (transfer_args*)arg;
+    uint32_t buf[64], next = 0;
+    while (next < args->total) {
+        size_t n = args->batch;
+        if (n > args->total - next)
+            n = args->total - next;
+        for (size_t i = 0; i < n; i ++)
+            buf[i] = next + i;
+        size_t pushed = n == 1 ? (args->rb->push(buf[0]) ? 1 : 0) : args->rb->push_n(buf, n);
+        if (pushed == 0)
+            sched_yield();
+        next += pushed;
+    }
+    return NULL;
+}
+
+// Transfer 'total' values from a producer thread to the calling thread, checking their order
+static double transfer(SPSCRingBuffer<uint32_t>& rb, uint32_t total, size_t batch, bool& ok) {
+    transfer_args args = {&rb, total, batch, true};
+    uint32_t buf[64], expected = 0;
+    struct timespec t0, t1;
+    pthread_t tid;
+
+    ok = true;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    TEST_ASSERT_EQUAL(0, pthread_create(&tid, NULL, producer_thread, &args));
+    while (expected < total) {
+        size_t n = batch == 1 ? (rb.pop(buf[0]) ? 1 : 0) : rb.pop_n(buf, batch);
+        if (n == 0)
+            sched_yield();
+        for (size_t i = 0; i < n; i ++)
+            ok = ok && (buf[i] == expected ++);
+    }
+    pthread_join(tid, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void test_threads() {
+    UAllocTraits_t traits = {0};
+    SPSCRingBuffer<uint32_t> rb;
+    TEST_ASSERT_TRUE(rb.init(64, traits));
+    bool ok;
+    transfer(rb, 100000, 1, ok);
+    TEST_ASSERT_TRUE(ok);
+    transfer(rb, 100000, 7, ok);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_TRUE(rb.is_empty());
+}
+
+static void benchmark_spsc_ring_buffer() {
+    const uint32_t total = 4000000;
+    const size_t batches[] = {1, 8, 64};
+    UAllocTraits_t traits = {0};
+
+    printf("%10s %18s\r\n", "batch", "throughput (M/s)");
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b ++) {
+        SPSCRingBuffer<uint32_t> rb;
+        TEST_ASSERT_TRUE(rb.init(1024, traits));
+        bool ok;
+        double secs = transfer(rb, total, batches[b], ok);
+        TEST_ASSERT_TRUE(ok);
+        printf("%10u %18.1f\r\n", (unsigned)batches[b], total / secs / 1e6);
+    }
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("SPSCRingBuffer  - push and pop", test_push_pop, greentea_failure_handler),
+    Case("SPSCRingBuffer  - batches", test_batch, greentea_failure_handler),
+    Case("SPSCRingBuffer  - non POD elements", test_non_pod, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("SPSCRingBuffer  - producer and consumer threads", test_threads, greentea_failure_handler),
+    Case("SPSCRingBuffer  - benchmark", benchmark_spsc_ring_buffer, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -0,0 +1,228 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/SmallArray.h"
+#include "core-util/ArrayAlgorithms.h"
+#include "core-util/BinaryHeap.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+struct Counted {
+    Counted(unsigned v = 0): value(v) {
+        inst_count ++;
+    }
+
+    Counted(const Counted& c): value(c.value) {
+        inst_count ++;
+    }
+
+    ~Counted() {
+        inst_count --;
+    }
+
+    unsigned value;
+    static int inst_count;
+};
+
+int Counted::inst_count = 0;
+
+static void test_small_array() {
+    {
+    SmallArray<Counted, 4> array;
+    UAllocTraits_t traits = {0};
+
+    TEST_ASSERT_FALSE(array.is_inline()); // not initialized
+    TEST_ASSERT_TRUE(array.init(3, traits));
+    TEST_ASSERT_TRUE(array.is_inline());
+    TEST_ASSERT_EQUAL(4, array.get_inline_capacity());
+    TEST_ASSERT_EQUAL(4, array.get_capacity());
+
+    // The first elements are stored inside the object
+    for (unsigned i = 0; i < 4; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Counted(i)));
+        const uint8_t *p = (const uint8_t*)&array[i];
+        TEST_ASSERT_TRUE((p >= (const uint8_t*)&array) && (p < (const uint8_t*)&array + sizeof(array)));
+    }
+    TEST_ASSERT_TRUE(array.is_inline());
+    TEST_ASSERT_EQUAL(1, array.get_num_zones());
+
+    // The next ones spill to zones allocated with mbed_ualloc
+    for (unsigned i = 4; i < 20; i ++) {
+        TEST_ASSERT_TRUE(array.push_back(Counted(i)));
+    }
+    TEST_ASSERT_FALSE(array.is_inline());
+    TEST_ASSERT_EQUAL(1 + (16 + 2) / 3, array.get_num_zones());
+    TEST_ASSERT_EQUAL(20, Counted::inst_count);
+    for (unsigned i = 0; i < 20; i ++) {
+        TEST_ASSERT_EQUAL(i, array.at(i).value);
+    }
+
+    // Shrinking moves the elements back inside the object if they fit
+    while (array.get_num_elements() > 3) {
+        TEST_ASSERT_TRUE(array.pop_back());
+    }
+    TEST_ASSERT_TRUE(array.shrink_to_fit());
+    TEST_ASSERT_TRUE(array.is_inline());
+    TEST_ASSERT_EQUAL(4, array.get_capacity());
+    TEST_ASSERT_EQUAL(3, Counted::inst_count);
+    for (unsigned i = 0; i < 3; i ++) {
+        TEST_ASSERT_EQUAL(i, array[i].value);
+    }
+    TEST_ASSERT_TRUE(array.push_back(Counted(3)));
+    TEST_ASSERT_TRUE(array.push_back(Counted(4)));
+    TEST_ASSERT_EQUAL(2, array.get_num_zones());
+    TEST_ASSERT_EQUAL(4, array[4].value);
+    }
+    TEST_ASSERT_EQUAL(0, Counted::inst_count);
+}
+
+static void test_small_array_as_array() {
+    // A SmallArray can be passed to everything that takes an Array
+    SmallArray<int, 8> array;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(array.init(8, traits));
+    Array<int>& base = array;
+    TEST_ASSERT_FALSE(base.init(4, 4, traits)); // the inline storage can't be replaced
+    TEST_ASSERT_TRUE(array.is_inline());
+    const int values[] = {5, -3, 12, 0, 7, 7, -8, 1, 30, 2};
+    TEST_ASSERT_TRUE(array.append(values, sizeof(values) / sizeof(values[0])));
+
+    sort(array);
+    for (unsigned i = 1; i < array.get_num_elements(); i ++) {
+        TEST_ASSERT_TRUE(array[i - 1] <= array[i]);
+    }
+    BinaryHeap<int, MaxCompare<int> > heap;
+    TEST_ASSERT_TRUE(heap.init(4, 4, traits));
+    TEST_ASSERT_TRUE(heap.build_from(array));
+    TEST_ASSERT_EQUAL(array.get_num_elements(), heap.get_num_elements());
+    TEST_ASSERT_EQUAL(30, heap.get_root());
+    TEST_ASSERT_TRUE(heap.is_consistent());
+}
+
+static void test_small_array_modes() {
+    UAllocTraits_t traits = {0};
+
+    // Contiguous mode: the elements leave the object when the array grows, and come back on shrink
+    SmallArray<uint32_t, 8> contiguous;
+    TEST_ASSERT_TRUE(contiguous.init(8, traits, array_contiguous));
+    for (unsigned i = 0; i < 8; i ++) {
+        contiguous.push_back(i);
+    }
+    TEST_ASSERT_TRUE(contiguous.is_inline());
+    contiguous.push_back(8);
+    TEST_ASSERT_FALSE(contiguous.is_inline());
+    TEST_ASSERT_EQUAL(1, contiguous.get_num_zones());
+    for (unsigned i = 0; i < 9; i ++) {
+        TEST_ASSERT_EQUAL(i, contiguous.data()[i]);
+    }
+    contiguous.pop_back();
+    contiguous.pop_back();
+    TEST_ASSERT_TRUE(contiguous.shrink_to_fit());
+    TEST_ASSERT_TRUE(contiguous.is_inline());
+    for (unsigned i = 0; i < 7; i ++) {
+        TEST_ASSERT_EQUAL(i, contiguous.data()[i]);
+    }
+
+    // Concurrent mode keeps its ready flags inside the object too
+    SmallArray<uint8_t, 5> concurrent;
+    TEST_ASSERT_TRUE(concurrent.init(5, traits, array_concurrent));
+    for (unsigned i = 0; i < 12; i ++) {
+        TEST_ASSERT_TRUE(concurrent.push_back(i));
+    }
+    TEST_ASSERT_EQUAL(12, concurrent.get_num_elements());
+    TEST_ASSERT_EQUAL(3, concurrent.get_num_zones());
+    for (unsigned i = 0; i < 12; i ++) {
+        TEST_ASSERT_EQUAL(i, concurrent[i]);
+    }
+
+    // A SmallArray that can't grow never allocates memory
+    SmallArray<uint16_t, 2> fixed;
+    TEST_ASSERT_TRUE(fixed.init(0, traits));
+    TEST_ASSERT_TRUE(fixed.push_back(1));
+    TEST_ASSERT_TRUE(fixed.push_back(2));
+    TEST_ASSERT_FALSE(fixed.push_back(3));
+    TEST_ASSERT_TRUE(fixed.is_inline());
+}
+
+#if defined(TARGET_LIKE_POSIX)
+static void benchmark_small_array() {
+    const unsigned iterations = 100000, elements = 6;
+    UAllocTraits_t traits = {0};
+    unsigned sum1 = 0, sum2 = 0, values[elements] = {0};
+
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (unsigned k = 0; k < iterations; k ++) {
+        Array<unsigned> array;
+        array.init(8, 8, traits);
+        values[0] = k;
+        array.append(values, elements);
+        sum1 += array[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (unsigned k = 0; k < iterations; k ++) {
+        SmallArray<unsigned, 8> array;
+        array.init(8, traits);
+        values[0] = k;
+        array.append(values, elements);
+        sum2 += array[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    TEST_ASSERT_EQUAL(sum1, sum2);
+    double ns1 = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    double ns2 = (t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec);
+    printf("%32s %18s\r\n", "short-lived array (6 elements)", "lifetime (ns)");
+    printf("%32s %18.1f\r\n", "Array<unsigned>", ns1 / iterations);
+    printf("%32s %18.1f\r\n", "SmallArray<unsigned, 8>", ns2 / iterations);
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(10, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("SmallArray  - test", test_small_array, greentea_failure_handler),
+    Case("SmallArray  - used as an Array", test_small_array_as_array, greentea_failure_handler),
+    Case("SmallArray  - test storage modes", test_small_array_modes, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("SmallArray  - benchmark short-lived arrays", benchmark_small_array, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -0,0 +1,227 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/SoAArray.h"
+#include "greentea-client/test_env.h"
+#include "mbed-drivers/mbed.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+struct Counted {
+    Counted(unsigned v = 0): value(v) {
+        inst_count ++;
+    }
+
+    Counted(const Counted& c): value(c.value) {
+        inst_count ++;
+    }
+
+    ~Counted() {
+        inst_count --;
+    }
+
+    unsigned value;
+    static int inst_count;
+};
+
+int Counted::inst_count = 0;
+
+static void test_soa_array() {
+    {
+    SoAArray<uint32_t, float, uint8_t, Counted> table;
+    UAllocTraits_t traits = {0};
+
+    TEST_ASSERT_FALSE(table.push_back(1, 1.0f, 1, Counted(1))); // not initialized
+    TEST_ASSERT_TRUE(table.init(10, 7, traits));
+    TEST_ASSERT_FALSE(table.init(10, 7, traits));
+    TEST_ASSERT_EQUAL(4, table.get_num_fields());
+    TEST_ASSERT_EQUAL(10, table.get_capacity());
+
+    const unsigned total = 100;
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_TRUE(table.push_back(i, i * 0.5f, i & 0xFF, Counted(i * 3)));
+    }
+    TEST_ASSERT_EQUAL(total, table.get_num_elements());
+    TEST_ASSERT_EQUAL(total, Counted::inst_count);
+    for (unsigned i = 0; i < total; i ++) {
+        TEST_ASSERT_EQUAL(i, table.get<0>(i));
+        TEST_ASSERT_TRUE(table.get<1>(i) == i * 0.5f);
+        TEST_ASSERT_EQUAL(i & 0xFF, table.at<2>(i));
+        TEST_ASSERT_EQUAL(i * 3, table.at<3>(i).value);
+    }
+
+    // Each column is a dense array of its field
+    TEST_ASSERT_EQUAL(total, table.column<2>().get_num_elements());
+    TEST_ASSERT_EQUAL(table.column<0>().get_num_zones(), table.column<2>().get_num_zones());
+    float sum = 0;
+    unsigned spans = 0;
+    table.for_each_span<1>([&](const float *values, size_t count) {
+        for (size_t i = 0; i < count; i ++) {
+            sum += values[i];
+        }
+        spans ++;
+    });
+    TEST_ASSERT_TRUE(sum == total * (total - 1) / 4.0f);
+    TEST_ASSERT_EQUAL(table.column<1>().get_num_zones(), spans);
+
+    // Fields can be modified in place
+    table.get<0>(5) = 500;
+    TEST_ASSERT_EQUAL(500, table.column<0>()[5]);
+
+    // Removing elements removes them from all the columns
+    TEST_ASSERT_TRUE(table.pop_back());
+    TEST_ASSERT_EQUAL(total - 1, table.get_num_elements());
+    TEST_ASSERT_EQUAL(total - 1, table.column<3>().get_num_elements());
+    TEST_ASSERT_EQUAL(total - 1, Counted::inst_count);
+
+    TEST_ASSERT_TRUE(table.shrink_to_fit());
+    TEST_ASSERT_EQUAL(total - 1, table.get_capacity());
+    TEST_ASSERT_EQUAL(98, table.get<0>(98));
+    TEST_ASSERT_TRUE(table.reserve(200));
+    TEST_ASSERT_TRUE(table.get_capacity() >= 200);
+
+    table.clear();
+    TEST_ASSERT_EQUAL(0, table.get_num_elements());
+    TEST_ASSERT_EQUAL(0, Counted::inst_count);
+    TEST_ASSERT_FALSE(table.pop_back());
+    TEST_ASSERT_TRUE(table.push_back(1, 2.0f, 3, Counted(4)));
+    TEST_ASSERT_EQUAL(4, table.get<3>(0).value);
+    }
+    TEST_ASSERT_EQUAL(0, Counted::inst_count);
+}
+
+static void test_soa_array_fixed() {
+    // A table that can't grow rejects new elements in all the columns
+    SoAArray<uint16_t, uint64_t> table;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_TRUE(table.init(3, 0, traits));
+    for (unsigned i = 0; i < 3; i ++) {
+        TEST_ASSERT_TRUE(table.push_back(i, (uint64_t)i << 40));
+    }
+    TEST_ASSERT_FALSE(table.push_back(3, 3));
+    TEST_ASSERT_EQUAL(3, table.get_num_elements());
+    TEST_ASSERT_EQUAL(3, table.column<0>().get_num_elements());
+    TEST_ASSERT_EQUAL(3, table.column<1>().get_num_elements());
+    TEST_ASSERT_TRUE(table.get<1>(2) == (uint64_t)2 << 40);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+struct Block {
+    uint8_t data[1 << 20];
+};
+
+static void test_soa_array_out_of_memory() {
+    // The 'Block' column of this table needs 4TB, so it can't be allocated
+    const size_t huge = 1 << 22;
+    SoAArray<uint8_t, Block> table;
+    UAllocTraits_t traits = {0};
+    TEST_ASSERT_FALSE(table.init(huge, 1, traits));
+    // The first column was released, so the table can be initialized again
+    TEST_ASSERT_EQUAL(0, table.column<0>().get_capacity());
+    TEST_ASSERT_TRUE(table.init(2, 1, traits));
+    TEST_ASSERT_EQUAL(2, table.get_capacity());
+
+    // A failed reserve() can grow some of the columns, but the capacity is the smallest one
+    TEST_ASSERT_FALSE(table.reserve(huge));
+    TEST_ASSERT_TRUE(table.column<0>().get_capacity() >= huge);
+    TEST_ASSERT_EQUAL(2, table.get_capacity());
+    TEST_ASSERT_TRUE(table.shrink_to_fit());
+    TEST_ASSERT_EQUAL(0, table.get_capacity());
+}
+
+struct Record {
+    uint32_t id;
+    float value;
+    uint8_t payload[56];
+};
+
+static void benchmark_soa_array_scan() {
+    const unsigned total = 1 << 18, rounds = 16;
+    UAllocTraits_t traits = {0};
+    Array<Record> records;
+    SoAArray<uint32_t, float, Record> table;
+    TEST_ASSERT_TRUE(records.init(4096, 4096, traits, alignof(Record)));
+    TEST_ASSERT_TRUE(table.init(4096, 4096, traits));
+    Record r = {0, 0, {0}};
+    for (unsigned i = 0; i < total; i ++) {
+        r.id = i;
+        r.value = (float)(i & 0xFF);
+        TEST_ASSERT_TRUE(records.push_back(r));
+        TEST_ASSERT_TRUE(table.push_back(r.id, r.value, r));
+    }
+
+    float sum_aos = 0, sum_soa = 0;
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (unsigned k = 0; k < rounds; k ++) {
+        records.for_each_span([&sum_aos](const Record *p, size_t count) {
+            for (size_t i = 0; i < count; i ++) {
+                sum_aos += p[i].value;
+            }
+        });
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (unsigned k = 0; k < rounds; k ++) {
+        table.for_each_span<1>([&sum_soa](const float *p, size_t count) {
+            for (size_t i = 0; i < count; i ++) {
+                sum_soa += p[i];
+            }
+        });
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    TEST_ASSERT_TRUE(sum_aos == sum_soa);
+    double ns_aos = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    double ns_soa = (t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec);
+    printf("%28s %18s\r\n", "scan of one float field", "element (ns)");
+    printf("%28s %18.3f\r\n", "Array<Record>", ns_aos / (total * rounds));
+    printf("%28s %18.3f\r\n", "SoAArray column", ns_soa / (total * rounds));
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+static Case cases[] = {
+    Case("SoAArray  - test", test_soa_array, greentea_failure_handler),
+    Case("SoAArray  - test with fixed capacity", test_soa_array_fixed, greentea_failure_handler),
+#if defined(TARGET_LIKE_POSIX)
+    Case("SoAArray  - test out of memory", test_soa_array_out_of_memory, greentea_failure_handler),
+    Case("SoAArray  - benchmark field scan", benchmark_soa_array_scan, greentea_failure_handler),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}
@@ -0,0 +1,146 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2016 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/zero_memory.h"
+#include "core-util/PoolAllocator.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(TARGET_LIKE_POSIX)
+#include <time.h>
+#endif
+
+using namespace utest::v1;
+using namespace mbed::util;
+
+static void test_zero_memory() {
+    const size_t max_size = 300, guard = 16;
+    uint8_t *buf = (uint8_t*)malloc(max_size + 2 * guard + 16);
+    TEST_ASSERT_TRUE(buf != NULL);
+
+    // Check all the sizes up to 'max_size' at all the offsets in a vector
+    for (size_t offset = 0; offset < 16; offset ++) {
+        for (size_t size = 0; size <= max_size; size ++) {
+            memset(buf, 0xFF, max_size + 2 * guard + 16);
+            uint8_t *p = buf + guard + offset;
+            zero_memory(p, size);
+            for (size_t i = 0; i < size; i ++) {
+                TEST_ASSERT_EQUAL(0, p[i]);
+            }
+            // Nothing outside the area was touched
+            for (uint8_t *q = buf; q < p; q ++) {
+                TEST_ASSERT_EQUAL(0xFF, *q);
+            }
+            for (uint8_t *q = p + size; q < buf + max_size + 2 * guard + 16; q ++) {
+                TEST_ASSERT_EQUAL(0xFF, *q);
+            }
+        }
+    }
+    free(buf);
+
+    // Large enough to use non-temporal stores
+    const size_t large_size = MBED_UTIL_ZERO_MEMORY_NON_TEMPORAL_THRESHOLD + 100;
+    buf = (uint8_t*)malloc(large_size + 1);
+    if (buf != NULL) {
+        memset(buf, 0xFF, large_size + 1);
+        zero_memory(buf + 1, large_size - 1);
+        TEST_ASSERT_EQUAL(0xFF, buf[0]);
+        for (size_t i = 1; i < large_size; i ++) {
+            TEST_ASSERT_EQUAL(0, buf[i]);
+        }
+        TEST_ASSERT_EQUAL(0xFF, buf[large_size]);
+        free(buf);
+    }
+}
+
+static void test_pool_allocator_calloc() {
+    const size_t elements = 4, element_size = 100;
+    const size_t pool_size = PoolAllocator::get_pool_size(elements, element_size);
+    uint8_t *start = (uint8_t*)malloc(pool_size);
+    TEST_ASSERT_TRUE(start != NULL);
+    memset(start, 0xFF, pool_size);
+    PoolAllocator allocator(start, elements, element_size);
+
+    for (size_t i = 0; i < elements; i ++) {
+        uint8_t *p = (uint8_t*)allocator.calloc();
+        // calloc() must return the start of the element
+        TEST_ASSERT_EQUAL(start + i * PoolAllocator::align_up(element_size, MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN), p);
+        for (size_t j = 0; j < element_size; j ++) {
+            TEST_ASSERT_EQUAL(0, p[j]);
+        }
+    }
+    TEST_ASSERT_EQUAL(NULL, allocator.calloc());
+    free(start);
+}
+
+#if defined(TARGET_LIKE_POSIX)
+// The word loop used by calloc() before zero_memory()
+static void __attribute__((noinline)) zero_memory_word_loop(void *ptr, size_t size) {
+    uint32_t *blk = (uint32_t*)ptr;
+    for (unsigned i = 0; i < size / 4; i ++, blk ++)
+        *blk = 0;
+}
+
+static double elapsed_ns(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static void benchmark_zero_memory() {
+    const size_t sizes[] = {8, 32, 64, 256, 1024, 4096, 65536, 1024 * 1024};
+    const size_t total_bytes = 64 * 1024 * 1024;
+    uint8_t *buf = (uint8_t*)malloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    TEST_ASSERT_TRUE(buf != NULL);
+
+    printf("%10s %16s %16s\r\n", "size", "word loop (ns)", "zero_memory (ns)");
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k ++) {
+        const size_t size = sizes[k], iterations = total_bytes / size;
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t i = 0; i < iterations; i ++)
+            zero_memory_word_loop(buf, size);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (size_t i = 0; i < iterations; i ++)
+            zero_memory(buf, size);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        printf("%10u %16.1f %16.1f\r\n", (unsigned)size, elapsed_ns(t0, t1) / iterations, elapsed_ns(t1, t2) / iterations);
+    }
+    free(buf);
+}
+#endif // #if defined(TARGET_LIKE_POSIX)
+
+static status_t test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(5, "default_auto");
+
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+static Case cases[] = {
+    Case("zero_memory  - test_zero_memory", test_zero_memory),
+    Case("zero_memory  - test_pool_allocator_calloc", test_pool_allocator_calloc),
+#if defined(TARGET_LIKE_POSIX)
+    Case("zero_memory  - benchmark_zero_memory", benchmark_zero_memory),
+#endif
+};
+
+static Specification specification(test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char**) {
+    Harness::run(specification);
+}